@@ -15,6 +15,7 @@ using std::exit;
 #include "caper_scanner.hpp"
 #include "caper_cpg.hpp"
 #include "caper_tgt.hpp"
+#include "caper_stats.hpp"
 #include "caper_generate_cpp.hpp"
 #include "caper_generate_js.hpp"
 #include "caper_generate_csharp.hpp"
@@ -36,7 +37,16 @@ struct commandline_options {
     std::string outfile;
     std::string language;
     std::string algorithm;
+    std::string lookahead;
+    int         threads;
+    std::string cache_dir;
+    std::string stats;
     bool        debug_parser;
+    bool        table_driven;
+    bool        computed_goto;
+    bool        glr;
+    bool        bypass_unit_rules;
+    bool        default_reductions;
 };
 
 void get_commandline_options(
@@ -45,7 +55,15 @@ void get_commandline_options(
     const char**            argv) {
     cmdopt.language = "C++";
     cmdopt.algorithm = "lalr1";
+    cmdopt.lookahead = "propagate";
+    cmdopt.threads = 1;
+    if (const char* p = getenv("CAPER_CACHE_DIR")) { cmdopt.cache_dir = p; }
     cmdopt.debug_parser = false;
+    cmdopt.table_driven = false;
+    cmdopt.computed_goto = false;
+    cmdopt.glr = false;
+    cmdopt.bypass_unit_rules = false;
+    cmdopt.default_reductions = false;
 
     int state = 0;
     for (int index = 1 ; index < argc ; index++) {
@@ -101,17 +119,60 @@ void get_commandline_options(
                 cmdopt.algorithm = "lalr1";
                 continue;
             }
+            if (arg == "--lookahead=propagate" || arg == "--lookahead=dp") {
+                cmdopt.lookahead = arg.substr(12);
+                continue;
+            }
+            if (arg.compare(0, 2, "-j") == 0) {
+                // -j N, -jN; 0 means all cores
+                std::string n = arg.substr(2);
+                if (n.empty() && index + 1 < argc) { n = argv[++index]; }
+                if (n.empty() ||
+                    n.find_first_not_of("0123456789") != std::string::npos) {
+                    std::cerr << "caper: -j needs a number" << std::endl;
+                    exit(1);
+                }
+                cmdopt.threads = atoi(n.c_str());
+                continue;
+            }
+            if (arg.compare(0, 12, "--cache-dir=") == 0) {
+                // empty disables the cache
+                cmdopt.cache_dir = arg.substr(12);
+                continue;
+            }
+            if (arg == "--stats" || arg == "--stats=text" ||
+                arg == "--stats=json") {
+                cmdopt.stats = arg == "--stats=json" ? "json" : "text";
+                continue;
+            }
             if (arg == "--debug") {
                 cmdopt.debug_parser = true;
                 continue;
             }
-            
-/*
-            if (arg == "-lr1") == 0) {
+            if (arg == "-lr1") {
                 cmdopt.algorithm = "lr1";
                 continue;
             }
-*/
+            if (arg == "-table") {
+                cmdopt.table_driven = true;
+                continue;
+            }
+            if (arg == "-goto") {
+                cmdopt.computed_goto = true;
+                continue;
+            }
+            if (arg == "-glr") {
+                cmdopt.glr = true;
+                continue;
+            }
+            if (arg == "--bypass-unit-rules") {
+                cmdopt.bypass_unit_rules = true;
+                continue;
+            }
+            if (arg == "--default-reductions") {
+                cmdopt.default_reductions = true;
+                continue;
+            }
 
             std::cerr << "caper: unknown option: " << argv[index] << std::endl;
             exit(1);
@@ -126,8 +187,33 @@ void get_commandline_options(
         }
     }
 
+    if (cmdopt.table_driven && cmdopt.language != "C++") {
+        std::cerr << "caper: -table is only for C++" << std::endl;
+        exit(1);
+    }
+    if (cmdopt.computed_goto && cmdopt.language != "C++") {
+        std::cerr << "caper: -goto is only for C++" << std::endl;
+        exit(1);
+    }
+    if (cmdopt.table_driven && cmdopt.computed_goto) {
+        std::cerr << "caper: -table and -goto are exclusive" << std::endl;
+        exit(1);
+    }
+    if (cmdopt.bypass_unit_rules && cmdopt.language != "C++") {
+        std::cerr << "caper: --bypass-unit-rules is only for C++" << std::endl;
+        exit(1);
+    }
+    if (cmdopt.glr && cmdopt.language != "C++") {
+        std::cerr << "caper: -glr is only for C++" << std::endl;
+        exit(1);
+    }
+    if (cmdopt.glr && (cmdopt.table_driven || cmdopt.computed_goto)) {
+        std::cerr << "caper: -glr and -table/-goto are exclusive" << std::endl;
+        exit(1);
+    }
+
     if (state < 2) {
-        std::cerr << "caper: usage: caper [-c++ | -js | -cs | -d | -java | -boo | -ruby | -php | -haxe] input_filename output_filename" << std::endl;
+        std::cerr << "caper: usage: caper [-c++ | -js | -cs | -d | -java | -boo | -ruby | -php | -haxe] [-table | -goto | -glr] [-lalr1 | -lr1] [--bypass-unit-rules] [--default-reductions] [--lookahead=propagate | --lookahead=dp] [-j N] [--cache-dir=DIR] [--stats[=text | =json]] input_filename output_filename" << std::endl;
         exit(1);
     }
 
@@ -145,7 +231,7 @@ int main(int argc, const char** argv) {
         const std::map<std::string, Type>&,
         const std::vector<std::string>&,
         const action_map_type&,
-        const tgt::parsing_table&);
+        const tgt::compact_table&);
 
     std::unordered_map<std::string, generator_type> generators;
     generators["C++"]           = generate_cpp;
@@ -158,6 +244,9 @@ int main(int argc, const char** argv) {
     generators["PHP"]           = generate_php;
     generators["Haxe"]          = generate_haxe;
 
+    // tF[Y̓v
+    run_stats stats(!cmdopt.stats.empty());
+
     std::ifstream ifs(cmdopt.infile.c_str());
     if (!ifs) {
         std::cerr << "caper: can't open input file '" << cmdopt.infile << "'" << std::endl;
@@ -178,6 +267,7 @@ int main(int argc, const char** argv) {
 
     try {
         // cpgp[T
+        stats.enter("parse");
         cpg::parser p;
         make_cpg_parser(p);
 
@@ -193,37 +283,102 @@ int main(int argc, const char** argv) {
                 throw syntax_error(v.range.beg, token);
             }
         }
+        stats.leave();
 
 
         // e̎W
         GenerateOptions options;
         options.debug_parser = cmdopt.debug_parser;
+        options.table_driven = cmdopt.table_driven;
+        options.computed_goto = cmdopt.computed_goto;
+        options.glr = cmdopt.glr;
+        options.default_reductions = cmdopt.default_reductions;
+        options.bypass_unit_rules = cmdopt.bypass_unit_rules;
 
         std::map<std::string, Type> terminal_types;
         std::map<std::string, Type> nonterminal_types;
+        stats.enter("collect_informations");
         collect_informations(
             options,
             terminal_types,
             nonterminal_types,
             p.accept_value());
+        stats.leave();
 
         // Ώە@̍\e[u̍쐬
-        tgt::parsing_table table;
+        zw::gr::lalr_options lalr_options;
+        if (cmdopt.lookahead == "dp") {
+            lalr_options.lookahead = zw::gr::lookahead_deremer_pennello;
+        }
+        if (cmdopt.algorithm == "lr1") {
+            lalr_options.algorithm = zw::gr::table_minimal_lr1;
+        }
+        lalr_options.threads = cmdopt.threads;
+
+        zw::gr::lalr_stats table_stats;
+        if (stats.enabled()) {
+            stats.attach(table_stats);
+            lalr_options.stats = &table_stats;
+        }
+
+        tgt::compact_table table;
         std::map<std::string, size_t> token_id_map;
         action_map_type actions;
+        stats.enter("make_target_parser");
         make_target_parser(
             table,
             token_id_map,
             actions,
             p.accept_value(),
             terminal_types,
-            nonterminal_types);
+            nonterminal_types,
+            lalr_options,
+            cmdopt.cache_dir);
+        stats.leave();
+
+        // unit rules without a semantic action, whose left side takes
+        // the value of the right side as it is: bypassed where their state
+        // does nothing else, and reduced by forward_unit elsewhere, so
+        // that the value is the same either way
+        if (cmdopt.bypass_unit_rules) {
+            stats.enter("bypass_unit_rules");
+            auto eliminable =
+                [&](const tgt::rule& r) {
+                    if (actions.count(r)) { return false; }
+                    auto left = nonterminal_types.find(r.left().name());
+                    if (left == nonterminal_types.end()) { return false; }
+                    const auto& x = r.right()[0];
+                    const auto& types =
+                        x.is_terminal() ? terminal_types : nonterminal_types;
+                    auto right = types.find(
+                        x.is_terminal() ? x.display() : x.name());
+                    if (right == types.end()) { return false; }
+                    return
+                        (*left).second.extension == Extension::None &&
+                        (*right).second.extension == Extension::None &&
+                        ((*left).second.name.empty() ||
+                         (*left).second.name == (*right).second.name);
+                };
+            table = table.bypass_unit_rules(eliminable);
+
+            std::vector<tgt::rule> forwarded;
+            for (const auto& r: table.get_grammar()) {
+                if (r.right().size() == 1 && eliminable(r)) {
+                    forwarded.push_back(r);
+                }
+            }
+            for (const auto& r: forwarded) {
+                actions[r] = SemanticAction { "forward_unit", true };
+            }
+            stats.leave();
+        }
 
         // ^[Qbgp[T̏o
         std::vector<std::string> tokens(token_id_map.size());
         for (const auto& x: token_id_map) {
             tokens[x.second] = x.first;
         }
+        stats.enter("emit");
         generators[cmdopt.language](
             cmdopt.outfile,
             ofs,
@@ -233,7 +388,17 @@ int main(int argc, const char** argv) {
             tokens,
             actions,
             table);
+        ofs.flush();
+        stats.leave();
 
+        if (stats.enabled()) {
+            count_table(stats, table, table_stats, tokens.size());
+            if (cmdopt.stats == "json") {
+                stats.write_json(std::cout, cmdopt.infile);
+            } else {
+                stats.write_text(std::cout, cmdopt.infile);
+            }
+        }
     }
     catch(caper_error& e) {
         if (e.addr <0) {
@@ -258,6 +258,10 @@ struct DontUseSTLDecl : public Declaration {
     DontUseSTLDecl(const Range& r) : Declaration(r) {}
 };
 
+struct TypedStackDecl : public Declaration {
+    TypedStackDecl(const Range& r) : Declaration(r) {}
+};
+
 struct Declarations : public Node {
     typedef std::vector<std::shared_ptr<Declaration>> declarations_type;
 
@@ -297,6 +301,12 @@ struct GenerateOptions {
     bool            recovery        = false;
     std::string     recovery_token  = "error";
     std::string     smart_pointer_tag   = "";
+    bool            typed_stack     = false;
+    bool            table_driven    = false;
+    bool            computed_goto   = false;
+    bool            default_reductions  = false;
+    bool            bypass_unit_rules   = false;
+    bool            glr             = false;
 };
 
 struct Type {
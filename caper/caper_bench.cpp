@@ -0,0 +1,476 @@
+// Copyright (C) 2006 Naoyuki Hirayama.
+// All Rights Reserved.
+
+// caper_bench: table construction over a corpus of grammars
+//
+//   caper_bench [-n REPEAT] [-j THREADS] [-s SIZE] [--json]
+//               [--no-synthetic] [grammar.cpg ...]
+//
+//   Every grammar is built by each engine REPEAT times; the best time is
+//   reported with the state count and the heap the build took (bytes
+//   allocated, and the most held at once).  Besides the given files the
+//   corpus has caper's own grammar and synthetic grammars of four
+//   families, at SIZE, 4*SIZE and 16*SIZE:
+//
+//     ladder  deep precedence ladder, a level per operator
+//     wide    one statement nonterminal with many alternatives
+//     long    long right hand sides
+//     ebnf    every rule made of ?, *, + and / items
+
+#include "fastlalr.hpp"
+#include "honalee.hpp"
+#include "caper_error.hpp"
+#include "caper_scanner.hpp"
+#include "caper_cpg.hpp"
+#include "caper_tgt.hpp"
+#include "caper_stats.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct bench_options {
+    int                         repeat = 3;
+    int                         threads = 1;
+    int                         size = 8;
+    bool                        json = false;
+    bool                        synthetic = true;
+    std::vector<std::string>    files;
+};
+
+struct measure {
+    std::string     grammar;
+    std::string     engine;
+    size_t          rules;
+    size_t          states;
+    double          ms;             // best of the runs
+    size_t          allocations;
+    size_t          bytes;
+    std::ptrdiff_t  peak;           // most held at once over the build
+    std::string     error;
+};
+
+////////////////////////////////////////////////////////////////
+// synthetic grammars
+std::string tokens(const std::string& prefix, int n) {
+    std::string s;
+    for (int i = 0 ; i < n ; i++) {
+        s += " " + prefix + std::to_string(i) + "<int>";
+    }
+    return s;
+}
+
+std::string ladder_grammar(int n) {
+    std::ostringstream os;
+    os << "%token Num<int> LParen<int> RParen<int>" << tokens("Op", n)
+       << ";\n%namespace ladder;\n\n";
+    for (int i = 0 ; i < n ; i++) {
+        std::string e = "E" + std::to_string(i);
+        std::string next = i + 1 < n ? "E" + std::to_string(i + 1) : "Atom";
+        os << e << "<int> : [] " << e << " Op" << i << " " << next
+           << "\n     | [] " << next << "\n     ;\n";
+    }
+    os << "Atom<int> : [] Num\n     | [] LParen E0 RParen\n     ;\n";
+    return os.str();
+}
+
+std::string wide_grammar(int n) {
+    std::ostringstream os;
+    os << "%token Id<int> Num<int> Semi<int> Comma<int>" << tokens("K", n)
+       << ";\n%namespace wide;\n\n"
+       << "Program<int> : [] Stmt\n     | [] Program Stmt\n     ;\n"
+       << "Stmt<int>";
+    for (int i = 0 ; i < n ; i++) {
+        os << (i == 0 ? " : [] K" : "\n     | [] K") << i;
+        switch (i % 3) {
+            case 0: os << " Args Semi"; break;
+            case 1: os << " Id Args Semi"; break;
+            case 2: os << " Semi"; break;
+        }
+    }
+    os << "\n     ;\n"
+       << "Args<int> : [] Arg\n     | [] Args Comma Arg\n     ;\n"
+       << "Arg<int> : [] Id\n     | [] Num\n     ;\n";
+    return os.str();
+}
+
+std::string long_grammar(int n) {
+    const int rules = 8;
+    static const char* const fill[] = { "A", "B", "Val", "C" };
+
+    std::ostringstream os;
+    os << "%token Id<int> Num<int> LParen<int> RParen<int> "
+       << "A<int> B<int> C<int> Semi<int>" << tokens("X", rules)
+       << ";\n%namespace long_rhs;\n\n"
+       << "Start<int> : [] Item\n     | [] Start Item\n     ;\n"
+       << "Item<int>";
+    for (int i = 0 ; i < rules ; i++) {
+        os << (i == 0 ? " : [] X" : "\n     | [] X") << i;
+        for (int j = 0 ; j < n ; j++) {
+            os << " " << fill[(i + j) % 4];
+        }
+        os << " Semi";
+    }
+    os << "\n     ;\n"
+       << "Val<int> : [] Id\n     | [] Num\n     | [] LParen Val RParen\n"
+       << "     ;\n";
+    return os.str();
+}
+
+std::string ebnf_grammar(int n) {
+    std::ostringstream os;
+    os << "%token Id<int> Num<int> Comma<int> Semi<int> LBrace<int> "
+       << "RBrace<int>" << tokens("H", n)
+       << ";\n%namespace ebnf;\n%allow_ebnf;\n\n"
+       << "Unit<int> : [] Decl+\n     ;\n"
+       << "Decl<int>";
+    for (int i = 0 ; i < n ; i++) {
+        os << (i == 0 ? " : [] D" : "\n     | [] D") << i;
+    }
+    os << "\n     ;\n";
+    for (int i = 0 ; i < n ; i++) {
+        os << "D" << i << "<int> : [] H" << i << " Id? LBrace F" << i
+           << "* RBrace\n     | [] H" << i << " Num/Comma Semi\n"
+           << "     | [] H" << i << " Semi Decl* RBrace\n     ;\n"
+           << "F" << i << "<int> : [] Id Num\n     | [] Semi\n     ;\n";
+    }
+    return os.str();
+}
+
+////////////////////////////////////////////////////////////////
+// the target grammar of a .cpg source, as caper reads it
+void read_grammar(
+    tgt::grammar&       g,
+    int&                error_token,
+    const std::string&  source) {
+
+    typedef std::string::const_iterator iterator;
+    scanner<iterator> s(source.begin(), source.end());
+
+    cpg::parser p;
+    make_cpg_parser(p);
+
+    Token token = token_empty;
+    while (token != token_eof) {
+        value_type v;
+        token = s.get(v);
+        try {
+            p.push(token, v);
+        }
+        catch(zw::gr::syntax_error&) {
+            throw syntax_error(v.range.beg, token);
+        }
+    }
+
+    GenerateOptions options;
+    std::map<std::string, Type> terminal_types;
+    std::map<std::string, Type> nonterminal_types;
+    collect_informations(
+        options, terminal_types, nonterminal_types, p.accept_value());
+
+    std::map<std::string, size_t> token_id_map;
+    action_map_type actions;
+    make_target_grammar(
+        g,
+        error_token,
+        token_id_map,
+        actions,
+        p.accept_value(),
+        terminal_types,
+        nonterminal_types);
+}
+
+////////////////////////////////////////////////////////////////
+// engines
+template <class Token, class Traits>
+struct engine {
+    typedef zw::gr::grammar<Token, Traits>          grammar_type;
+    typedef zw::gr::parsing_table<Token, Traits>    table_type;
+    typedef zw::gr::null_reporter<Token, Traits>    reporter_type;
+
+    std::string name;
+
+    // prepares the grammar once, untimed, and returns the timed build
+    std::function<
+        std::function<size_t ()> (const grammar_type&, Token)> prepare;
+};
+
+template <class Token, class Traits>
+std::vector<engine<Token, Traits>> engines(const bench_options& options) {
+    typedef engine<Token, Traits> engine_type;
+    typedef typename engine_type::grammar_type grammar_type;
+    typedef typename engine_type::table_type table_type;
+    typedef typename engine_type::reporter_type reporter_type;
+
+    auto lalr = [](zw::gr::lalr_options o) {
+        return [o](const grammar_type& g, Token error_token) {
+            return std::function<size_t ()>([&g, error_token, o]() {
+                table_type table;
+                zw::gr::make_lalr_table(
+                    table, g, error_token,
+                    reporter_type(), reporter_type(), o);
+                return table.states().size();
+            });
+        };
+    };
+
+    std::vector<engine_type> v;
+
+    zw::gr::lalr_options propagation;
+    v.push_back(engine_type { "lalr", lalr(propagation) });
+
+    if (options.threads != 1) {
+        zw::gr::lalr_options parallel;
+        parallel.threads = options.threads;
+        v.push_back(
+            engine_type {
+                "lalr -j" + std::to_string(options.threads),
+                lalr(parallel) });
+    }
+
+    zw::gr::lalr_options dp;
+    dp.lookahead = zw::gr::lookahead_deremer_pennello;
+    v.push_back(engine_type { "lalr dp", lalr(dp) });
+
+    v.push_back(
+        engine_type {
+            "lr1",
+            [](const grammar_type& g, Token error_token) {
+                return std::function<size_t ()>([&g, error_token]() {
+                    table_type table;
+                    zw::gr::make_lr1_table(
+                        table, g, error_token,
+                        reporter_type(), reporter_type());
+                    return table.states().size();
+                });
+            } });
+
+    return v;
+}
+
+template <class Token, class Traits>
+void run(
+    std::vector<measure>&                   results,
+    const bench_options&                    options,
+    const std::string&                      name,
+    const zw::gr::grammar<Token, Traits>&   g,
+    Token                                   error_token) {
+
+    typedef std::chrono::steady_clock clock;
+
+    for (const auto& e: engines<Token, Traits>(options)) {
+        measure m { name, e.name, g.size(), 0, 0, 0, 0, 0, "" };
+        try {
+            auto build = e.prepare(g, error_token);
+            for (int i = 0 ; i < options.repeat ; i++) {
+                reset_heap_peak();
+                heap_counters h0 = heap_now();
+                auto t0 = clock::now();
+                m.states = build();
+                auto t1 = clock::now();
+                heap_counters h1 = heap_now();
+
+                double ms =
+                    std::chrono::duration<double, std::milli>(t1 - t0).count();
+                if (i == 0 || ms < m.ms) { m.ms = ms; }
+                m.allocations = h1.allocations - h0.allocations;
+                m.bytes = h1.bytes - h0.bytes;
+                m.peak = h1.peak - h0.live;
+            }
+        }
+        catch(std::exception& x) {
+            m.error = x.what();
+        }
+        std::cerr << "caper_bench: " << name << ": " << e.name << std::endl;
+        results.push_back(m);
+    }
+}
+
+void run_source(
+    std::vector<measure>&   results,
+    const bench_options&    options,
+    const std::string&      name,
+    const std::string&      source) {
+
+    tgt::grammar g;
+    int error_token;
+    try {
+        read_grammar(g, error_token, source);
+    }
+    catch(caper_error& x) {
+        results.push_back(
+            measure { name, "-", 0, 0, 0, 0, 0, 0,
+                      "#" + std::to_string(x.addr) + ": " + x.what() });
+        return;
+    }
+    catch(std::exception& x) {
+        results.push_back(
+            measure { name, "-", 0, 0, 0, 0, 0, 0, x.what() });
+        return;
+    }
+    run(results, options, name, g, error_token);
+}
+
+////////////////////////////////////////////////////////////////
+// report
+void write_text(std::ostream& os, const std::vector<measure>& results) {
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%-24s %-12s %6s %8s %10s %10s %10s %10s\n",
+             "grammar", "engine", "rules", "states", "ms", "allocs",
+             "alloc KB", "peak KB");
+    os << buf;
+    for (const auto& m: results) {
+        if (!m.error.empty()) {
+            snprintf(buf, sizeof(buf), "%-24s %-12s error: %s\n",
+                     m.grammar.c_str(), m.engine.c_str(), m.error.c_str());
+        } else {
+            snprintf(buf, sizeof(buf),
+                     "%-24s %-12s %6zu %8zu %10.2f %10zu %10zu %10lld\n",
+                     m.grammar.c_str(), m.engine.c_str(), m.rules, m.states,
+                     m.ms, m.allocations, m.bytes / 1024,
+                     (long long)(m.peak / 1024));
+        }
+        os << buf;
+    }
+}
+
+std::string json_string(const std::string& s) {
+    std::string r = "\"";
+    for (char c: s) {
+        if (c == '"' || c == '\\') { r += '\\'; }
+        r += (unsigned char)c < 0x20 ? ' ' : c;
+    }
+    return r + "\"";
+}
+
+void write_json(std::ostream& os, const std::vector<measure>& results) {
+    os << "[";
+    bool first = true;
+    for (const auto& m: results) {
+        char ms[32];
+        snprintf(ms, sizeof(ms), "%.3f", m.ms);
+        os << (first ? "\n" : ",\n")
+           << "  { \"grammar\": " << json_string(m.grammar)
+           << ", \"engine\": " << json_string(m.engine);
+        if (!m.error.empty()) {
+            os << ", \"error\": " << json_string(m.error);
+        } else {
+            os << ", \"rules\": " << m.rules
+               << ", \"states\": " << m.states
+               << ", \"ms\": " << ms
+               << ", \"allocations\": " << m.allocations
+               << ", \"bytes\": " << m.bytes
+               << ", \"peak_bytes\": " << m.peak;
+        }
+        os << " }";
+        first = false;
+    }
+    os << "\n]\n";
+}
+
+void usage() {
+    std::cerr << "usage: caper_bench [-n REPEAT] [-j THREADS] [-s SIZE] "
+              << "[--json] [--no-synthetic] [grammar.cpg ...]" << std::endl;
+    exit(1);
+}
+
+bool get_options(bench_options& options, int argc, char** argv) {
+    for (int i = 1 ; i < argc ; i++) {
+        std::string arg = argv[i];
+        if (arg == "-n" || arg == "-j" || arg == "-s") {
+            if (argc <= i + 1) { return false; }
+            int x = atoi(argv[++i]);
+            if (arg == "-n") {
+                if (x < 1) { return false; }
+                options.repeat = x;
+            } else if (arg == "-j") {
+                if (x < 0) { return false; }
+                options.threads = x;
+            } else {
+                if (x < 1) { return false; }
+                options.size = x;
+            }
+        } else if (arg == "--json") {
+            options.json = true;
+        } else if (arg == "--no-synthetic") {
+            options.synthetic = false;
+        } else if (!arg.empty() && arg[0] == '-') {
+            return false;
+        } else {
+            options.files.push_back(arg);
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bench_options options;
+    if (!get_options(options, argc, argv)) { usage(); }
+
+    // heap counting is on for the whole run
+    run_stats counting(true);
+
+    std::vector<measure> results;
+
+    for (const auto& file: options.files) {
+        std::ifstream ifs(file.c_str());
+        if (!ifs) {
+            std::cerr << "caper_bench: can't open input file '" << file
+                      << "'" << std::endl;
+            exit(1);
+        }
+        std::string source(
+            (std::istreambuf_iterator<char>(ifs)),
+            std::istreambuf_iterator<char>());
+
+        std::string name = file.substr(file.find_last_of("/\\") + 1);
+        run_source(results, options, name, source);
+    }
+
+    // caper's own grammar, as make_cpg_parser builds it
+    {
+        cpg::grammar g;
+        cpg::parser p;
+        make_cpg_grammar(g, p);
+        run(results, options, "(caper)", g, token_error);
+    }
+
+    if (options.synthetic) {
+        typedef std::string (*family)(int);
+        static const struct { const char* name; family f; int scale; }
+        families[] = {
+            { "ladder", ladder_grammar,  1 },
+            { "wide",   wide_grammar,    8 },
+            { "long",   long_grammar,    4 },
+            { "ebnf",   ebnf_grammar,    1 },
+        };
+        for (const auto& x: families) {
+            for (int k = 1 ; k <= 16 ; k *= 4) {
+                int n = options.size * x.scale * k;
+                run_source(
+                    results, options,
+                    std::string(x.name) + "-" + std::to_string(n),
+                    x.f(n));
+            }
+        }
+    }
+
+    if (options.json) {
+        write_json(std::cout, results);
+    } else {
+        write_text(std::cout, results);
+    }
+    return 0;
+}
@@ -0,0 +1,273 @@
+// Copyright (C) 2006 Naoyuki Hirayama.
+// All Rights Reserved.
+
+#include "caper_cache.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <iterator>
+#include <unordered_map>
+#include <boost/filesystem/operations.hpp>
+
+namespace {
+
+const char* const table_magic = "caper-table 3";
+
+// 128bit digest made of two FNV-1a hashes
+struct digest_builder {
+    std::uint64_t h0 = 14695981039346656037ULL;
+    std::uint64_t h1 = 0x6c62272e07bb0142ULL;
+
+    void add(const void* p, size_t n) {
+        const unsigned char* s = static_cast<const unsigned char*>(p);
+        for (size_t i = 0 ; i < n ; i++) {
+            h0 = (h0 ^ s[i]) * 1099511628211ULL;
+            h1 = (h1 ^ s[i]) * 0x100000001b3ULL;
+            h1 ^= h1 >> 29;
+        }
+    }
+    void add(const std::string& s) { add(s.c_str(), s.size() + 1); }
+    void add(long long n) {
+        std::string s = std::to_string(n);
+        add(s);
+    }
+
+    std::string str() const {
+        char buf[33];
+        sprintf(buf, "%016llx%016llx",
+                (unsigned long long)h0, (unsigned long long)h1);
+        return buf;
+    }
+};
+
+// nonterminals in order of appearance; the cache refers to them by index
+std::vector<tgt::symbol> collect_nonterminals(const tgt::grammar& g) {
+    std::vector<tgt::symbol> v;
+    std::unordered_map<const std::string*, int> seen;
+    auto add = [&](const tgt::symbol& x) {
+        if (!x.is_nonterminal() || seen.count(x.identity())) { return; }
+        seen[x.identity()] = int(v.size());
+        v.push_back(x);
+    };
+    for (const auto& rule: g) {
+        add(tgt::symbol(rule.left()));
+        for (const auto& x: rule.right()) { add(x); }
+    }
+    return v;
+}
+
+std::string cache_path(
+    const std::string& dir, const std::string& name, const char* suffix) {
+    return (boost::filesystem::path(dir) / (name + suffix)).string();
+}
+
+// writes a temporary file and renames it, so that concurrent runs never
+// see a partial entry; failures just leave the cache as it was
+void write_cache_file(
+    const std::string& cache_dir,
+    const std::string& path,
+    const std::string& contents) {
+
+    boost::system::error_code ec;
+    boost::filesystem::create_directories(cache_dir, ec);
+
+    std::string tmp = path + "." + boost::filesystem::unique_path().string();
+    {
+        std::ofstream ofs(tmp, std::ios::binary);
+        if (!ofs) { return; }
+        ofs << contents;
+        if (!ofs) {
+            ofs.close();
+            boost::filesystem::remove(tmp, ec);
+            return;
+        }
+    }
+    boost::filesystem::rename(tmp, path, ec);
+    if (ec) { boost::filesystem::remove(tmp, ec); }
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////
+// table_digest
+std::string table_digest(
+    const tgt::grammar&             g,
+    int                             error_token,
+    const zw::gr::lalr_options&     lalr_options) {
+
+    digest_builder d;
+    d.add(std::string(table_magic));
+    d.add((long long)lalr_options.algorithm);
+    d.add((long long)error_token);
+    for (const auto& rule: g) {
+        d.add(std::string("rule"));
+        d.add(rule.left().name());
+        for (const auto& x: rule.right()) {
+            if (x.is_terminal()) {
+                d.add(std::string("t"));
+                d.add(x.display());
+                d.add((long long)x.token());
+            } else {
+                d.add(std::string("n"));
+                d.add(x.name());
+            }
+        }
+    }
+    return d.str();
+}
+
+////////////////////////////////////////////////////////////////
+// load_cached_table
+bool load_cached_table(
+    tgt::compact_table&             table,
+    std::vector<std::string>&       messages,
+    const std::string&              cache_dir,
+    const std::string&              digest,
+    const tgt::grammar&             g) {
+
+    std::ifstream ifs(
+        cache_path(cache_dir, digest, ".table"), std::ios::binary);
+    if (!ifs) { return false; }
+    std::string file(
+        (std::istreambuf_iterator<char>(ifs)),
+        std::istreambuf_iterator<char>());
+
+    // the header, the body, then the digest of the body on its own line
+    std::string header = std::string(table_magic) + '\n' + digest + '\n';
+    digest_builder d;
+    size_t digest_size = d.str().size() + 1;
+    if (file.size() < header.size() + digest_size ||
+        file.compare(0, header.size(), header) != 0 ||
+        file.back() != '\n') {
+        return false;
+    }
+    size_t body = file.size() - header.size() - digest_size;
+    d.add(file.data() + header.size(), body);
+    if (file.compare(header.size() + body, digest_size - 1, d.str()) != 0) {
+        return false;
+    }
+
+    std::istringstream is(file.substr(header.size(), body));
+    std::string line;
+
+    std::vector<tgt::symbol> nonterminals = collect_nonterminals(g);
+    int rule_count = int(g.size());
+
+    tgt::parsing_table t;
+    t.set_grammar(g);
+
+    int first_state, state_count;
+    if (!(is >> first_state >> state_count)) { return false; }
+    if (first_state < 0 || state_count <= first_state) { return false; }
+
+    for (int i = 0 ; i < state_count ; i++) {
+        int handle_error, action_count, goto_count, alternative_count;
+        if (!(is >> handle_error >> action_count >> goto_count >>
+              alternative_count)) {
+            return false;
+        }
+        auto& s = t.add_state();
+        s.handle_error = handle_error != 0;
+
+        for (int j = 0 ; j < action_count ; j++) {
+            int token, type, dest, rule;
+            if (!(is >> token >> type >> dest >> rule)) { return false; }
+            if (type < zw::gr::action_shift || zw::gr::action_error < type ||
+                rule < 0 || rule_count <= rule) {
+                return false;
+            }
+            if (type == zw::gr::action_shift &&
+                (dest < 0 || state_count <= dest)) {
+                return false;
+            }
+            s.action_table[token] = tgt::parsing_table::action(
+                zw::gr::action_t(type), dest, g.at(rule));
+        }
+        for (int j = 0 ; j < goto_count ; j++) {
+            int n, dest;
+            if (!(is >> n >> dest)) { return false; }
+            if (n < 0 || int(nonterminals.size()) <= n) { return false; }
+            if (dest < 0 || state_count <= dest) { return false; }
+            s.goto_table[nonterminals[n]] = dest;
+        }
+        for (int j = 0 ; j < alternative_count ; j++) {
+            int token, type, rule;
+            if (!(is >> token >> type >> rule)) { return false; }
+            if ((type != zw::gr::action_reduce &&
+                 type != zw::gr::action_accept) ||
+                rule < 0 || rule_count <= rule) {
+                return false;
+            }
+            s.alternative_table.insert(
+                std::make_pair(
+                    token,
+                    tgt::parsing_table::action(
+                        zw::gr::action_t(type), 0, g.at(rule))));
+        }
+    }
+    t.first_state(first_state);
+
+    int message_count;
+    if (!(is >> message_count)) { return false; }
+    std::getline(is, line);
+    std::vector<std::string> m;
+    for (int i = 0 ; i < message_count ; i++) {
+        if (!std::getline(is, line)) { return false; }
+        m.push_back(line);
+    }
+
+    table = tgt::compact_table(std::move(t));
+    messages.swap(m);
+    return true;
+}
+
+////////////////////////////////////////////////////////////////
+// save_cached_table
+void save_cached_table(
+    const std::string&              cache_dir,
+    const std::string&              digest,
+    const tgt::compact_table&       table,
+    const std::vector<std::string>& messages) {
+
+    std::vector<tgt::symbol> nonterminals =
+        collect_nonterminals(table.get_grammar());
+    std::unordered_map<const std::string*, int> index;
+    for (size_t i = 0 ; i < nonterminals.size() ; i++) {
+        index[nonterminals[i].identity()] = int(i);
+    }
+
+    std::stringstream ss;
+    ss << table.first_state() << ' ' << table.states().size() << '\n';
+    for (const auto& s: table.states()) {
+        ss << (s.handle_error ? 1 : 0) << ' '
+           << s.action_table.size() << ' '
+           << s.goto_table.size() << ' '
+           << s.alternative_table.size() << '\n';
+        for (const auto& x: s.action_table) {
+            const auto& a = x.second;
+            ss << x.first << ' ' << int(a.type) << ' '
+               << a.dest_index << ' ' << a.rule_index << '\n';
+        }
+        for (const auto& x: s.goto_table) {
+            ss << index[x.first.identity()] << ' ' << x.second << '\n';
+        }
+        for (const auto& x: s.alternative_table) {
+            const auto& a = x.second;
+            ss << x.first << ' ' << int(a.type) << ' '
+               << a.rule_index << '\n';
+        }
+    }
+    ss << messages.size() << '\n';
+    for (const auto& x: messages) {
+        ss << x << '\n';
+    }
+
+    std::string body = ss.str();
+    digest_builder d;
+    d.add(body.data(), body.size());
+    write_cache_file(
+        cache_dir, cache_path(cache_dir, digest, ".table"),
+        std::string(table_magic) + '\n' + digest + '\n' + body +
+        d.str() + '\n');
+}
@@ -0,0 +1,35 @@
+#ifndef CAPER_CACHE_HPP
+#define CAPER_CACHE_HPP
+
+#include "caper_ast.hpp"
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////
+// table cache
+//
+//   parsing tables kept in a directory as <digest>.table, where the
+//   digest covers the grammar (rules in order, symbol names and token
+//   numbers) and the options that change the table.  Conflict messages
+//   reported while building the table are stored with it and replayed
+//   on a hit.  A missing or unreadable entry is simply a miss.
+
+std::string table_digest(
+    const tgt::grammar&             g,
+    int                             error_token,
+    const zw::gr::lalr_options&     lalr_options);
+
+bool load_cached_table(
+    tgt::compact_table&             table,
+    std::vector<std::string>&       messages,
+    const std::string&              cache_dir,
+    const std::string&              digest,
+    const tgt::grammar&             g);
+
+void save_cached_table(
+    const std::string&              cache_dir,
+    const std::string&              digest,
+    const tgt::compact_table&       table,
+    const std::vector<std::string>& messages);
+
+#endif // CAPER_CACHE_HPP
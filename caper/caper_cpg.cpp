@@ -36,10 +36,8 @@ void make_rule(cpg::grammar& g, cpg::parser& p, const std::string& rule_name, F
 
 
 ////////////////////////////////////////////////////////////////
-// make_cpg_parser
-void make_cpg_parser(cpg::parser& p) {
-    cpg::grammar g;
-
+// make_cpg_grammar
+void make_cpg_grammar(cpg::grammar& g, cpg::parser& p) {
     // S
     make_rule(
         g, p,
@@ -146,6 +144,13 @@ void make_cpg_parser(cpg::parser& p) {
             return Value(args[0]);
         },
         "DontUseSTLDecl", token_semicolon);
+    make_rule(
+        g, p,
+        "Declaration", 
+        [](const arguments_type& args) -> Value {
+            return Value(args[0]);
+        },
+        "TypedStackDecl", token_semicolon);
 
     // ..%token錾
     make_rule(
@@ -287,6 +292,16 @@ void make_cpg_parser(cpg::parser& p) {
         },
         token_directive_dont_use_stl);
 
+    // ..%typed_stack錾
+    make_rule(
+        g, p,
+        "TypedStackDecl",
+        [](const arguments_type& args) -> Value {
+            auto p = std::make_shared<TypedStackDecl>(range(args));
+            return Value(p);
+        },
+        token_directive_typed_stack);
+
     // .@ZNV
     make_rule(
         g, p,
@@ -464,11 +479,17 @@ void make_cpg_parser(cpg::parser& p) {
             return Value(p);
         },
         token_identifier, token_slash, token_identifier);
+}
 
+////////////////////////////////////////////////////////////////
+// make_cpg_parser
+void make_cpg_parser(cpg::parser& p) {
+    cpg::grammar g;
+    make_cpg_grammar(g, p);
 
     // parsing table̍쐬
     cpg::parsing_table table;
     cpg::make_lalr_table(table, g, token_error);
 
-    p.reset(table);
+    p.reset(cpg::compact_table(table));
 }
@@ -3,6 +3,11 @@
 
 #include "caper_ast.hpp"
 
+////////////////////////////////////////////////////////////////
+// make_cpg_grammar
+//   caper's own grammar; the semantic actions are registered to p
+void make_cpg_grammar(cpg::grammar& g, cpg::parser& p);
+
 ////////////////////////////////////////////////////////////////
 // make_cpg_parser
 void make_cpg_parser(cpg::parser& p);
@@ -27,7 +27,7 @@ void generate_boo(
     const std::map<std::string, Type>&  nonterminal_types,
     const std::vector<std::string>&     tokens,
     const action_map_type&              actions,
-    const tgt::parsing_table&           table) {
+    const tgt::compact_table&           table) {
 
     if (options.allow_ebnf) {
         throw unsupported_feature("Boo", "EBNF");
@@ -71,7 +71,7 @@ $${tokens}
     std::set< semantic_action_entry > ss;
 
     for (action_map_type::const_iterator it = actions.begin(); it != actions.end(); ++it) {
-        const tgt::parsing_table::rule_type& rule = it->first;
+        const tgt::compact_table::rule_type& rule = it->first;
         const SemanticAction& sa = it->second;
 
         semantic_action_entry sae;
@@ -272,8 +272,8 @@ ${access_modifier}class Parser ():
         {"first_state", table.first_state()});
 
     // states handler
-    for (tgt::parsing_table::states_type::const_iterator i = table.states().begin(); i != table.states().end(); ++i) {
-        const tgt::parsing_table::state& s = *i;
+    for (tgt::compact_table::states_type::const_iterator i = table.states().begin(); i != table.states().end(); ++i) {
+        const tgt::compact_table::state& s = *i;
         // gotof header
         stencil(
             os, R"(
@@ -296,7 +296,7 @@ ${access_modifier}class Parser ():
                 continue;
             }
 
-            tgt::parsing_table::state::goto_table_type::const_iterator k =
+            tgt::compact_table::goto_table_type::const_iterator k =
                 (*i).goto_table.find(rule.left());
 
             if (k != (*i).goto_table.end()) {
@@ -345,7 +345,7 @@ ${access_modifier}class Parser ():
         // action table
         first = true;
         int ridx = 0;
-        for (tgt::parsing_table::state::action_table_type::const_iterator j = s.action_table.begin(); j != s.action_table.end(); ++j) {
+        for (tgt::compact_table::action_table_type::const_iterator j = s.action_table.begin(); j != s.action_table.end(); ++j) {
             // action header 
             stencil(
                 os, R"(
@@ -356,7 +356,7 @@ ${access_modifier}class Parser ():
                 {"token", tokens[(*j).first]});
             first = false;
             // action
-            const tgt::parsing_table::action* a = &(*j).second;
+            const tgt::compact_table::action* a = &(*j).second;
             switch( a->type ) {
             case zw::gr::action_shift:
                 stencil(
@@ -373,9 +373,9 @@ ${access_modifier}class Parser ():
       // reduce
 )");
                 {
-                    size_t base = a->rule.right().size();
+                    size_t base = table.rule(*a).right().size();
 
-                    const tgt::parsing_table::rule_type& rule = a->rule;
+                    const tgt::compact_table::rule_type& rule = table.rule(*a);
                     action_map_type::const_iterator k = actions.find( rule );
 
                     size_t nonterminal_index = std::distance(
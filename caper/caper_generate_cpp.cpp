@@ -8,9 +8,8 @@
 #include "caper_format.hpp"
 #include "caper_stencil.hpp"
 #include "caper_finder.hpp"
+#include "caper_error.hpp"
 #include <algorithm>
-#include <boost/tuple/tuple.hpp>
-#include <boost/tuple/tuple_comparison.hpp>
 
 namespace {
 
@@ -57,7 +56,7 @@ std::string make_arg_decl(const Type& x, size_t l, const std::string& smart_poin
 
 void make_signature(
     const std::map<std::string, Type>&      nonterminal_types,
-    const tgt::parsing_table::rule_type&    rule,
+    const tgt::compact_table::rule_type&    rule,
     const SemanticAction&                   sa,
     std::vector<std::string>&               signature,
     const std::string&                      smart_pointer_tag) {
@@ -98,17 +97,1449 @@ std::string normalize_sa_call(const std::string& s) {
     return prefix + s;
 }
 
+// row displacement: the rows of a sparse table overlaid in one vector,
+// the entry of row r for column c at base[r] + c.  check holds the base
+// of the row owning a slot; equal rows share a base and different rows
+// never do, so a slot belongs to a row iff its check is the row's base.
+struct packed_rows {
+    std::vector<int>    base;   // per row
+    std::vector<int>    check;  // per slot, -1 if free
+    std::vector<int>    value;  // per slot
+};
+
+typedef std::vector<std::pair<int, int>> sparse_row; // (column, value)
+
+void pack_rows(
+    packed_rows&                    p,
+    const std::vector<sparse_row>&  rows,
+    int                             width) {
+
+    // each distinct row once, larger rows first
+    std::map<sparse_row, int> bases;
+    std::vector<const sparse_row*> order;
+    for (const auto& row: rows) {
+        if (bases.insert(std::make_pair(row, -1)).second) {
+            order.push_back(&row);
+        }
+    }
+    std::stable_sort(
+        order.begin(), order.end(),
+        [](const sparse_row* x, const sparse_row* y) {
+            return y->size() < x->size();
+        });
+
+    std::vector<bool> taken;    // bases
+    size_t first_free = 0;
+    for (const sparse_row* row: order) {
+        int b = row->empty() ?
+            0 : std::max(0, int(first_free) - row->front().first);
+        for (;; b++) {
+            if (size_t(b) < taken.size() && taken[b]) { continue; }
+            bool fits = true;
+            for (const auto& x: *row) {
+                size_t i = b + x.first;
+                if (i < p.check.size() && p.check[i] != -1) {
+                    fits = false;
+                    break;
+                }
+            }
+            if (fits) { break; }
+        }
+
+        if (p.check.size() < size_t(b + width)) {
+            p.check.resize(b + width, -1);
+            p.value.resize(b + width, 0);
+        }
+        if (taken.size() <= size_t(b)) { taken.resize(b + 1); }
+        taken[b] = true;
+        for (const auto& x: *row) {
+            p.check[b + x.first] = b;
+            p.value[b + x.first] = x.second;
+        }
+        while (first_free < p.check.size() && p.check[first_free] != -1) {
+            first_free++;
+        }
+        bases[*row] = b;
+    }
+
+    p.base.clear();
+    for (const auto& row: rows) {
+        p.base.push_back(bases[row]);
+    }
+}
+
+// the most frequent eligible value of a row (fallback if none), which
+// then leaves the row
+int take_default(sparse_row& row, int fallback, bool (*eligible)(int)) {
+    std::map<int, int> counts;
+    int best = fallback;
+    int best_count = 0;
+    for (const auto& x: row) {
+        if (!eligible(x.second)) { continue; }
+        int n = ++counts[x.second];
+        if (best_count < n) {
+            best = x.second;
+            best_count = n;
+        }
+    }
+    row.erase(
+        std::remove_if(
+            row.begin(), row.end(),
+            [=](const std::pair<int, int>& x) { return x.second == best; }),
+        row.end());
+    return best;
+}
+
+// the smallest integer type holding the values
+std::string packed_type(const std::vector<int>& v) {
+    int lo = v.empty() ? 0 : *std::min_element(v.begin(), v.end());
+    int hi = v.empty() ? 0 : *std::max_element(v.begin(), v.end());
+    if (-128 <= lo && hi <= 127) { return "signed char"; }
+    if (-32768 <= lo && hi <= 32767) { return "short"; }
+    return "int";
+}
+
+void emit_array(
+    std::ostream&           os,
+    const std::string&      name,
+    const std::vector<int>& v) {
+    os << "        static constexpr " << packed_type(v) << " " << name
+       << "[] = {";
+    for (size_t i = 0 ; i < v.size() ; i++) {
+        os << (i % 16 == 0 ? "\n            " : " ") << v[i] << ",";
+    }
+    os << "\n        };\n";
+}
+
+// the call of the stub reducing by rule
+std::string reduce_call(
+    const GenerateOptions&                          options,
+    const std::map<std::string, Type>&              nonterminal_types,
+    const action_map_type&                          actions,
+    const tgt::compact_table::rule_type&            rule,
+    const std::map<std::vector<std::string>, int>&  stub_indices) {
+
+    std::string args =
+        "(Nonterminal_" + rule.left().name() + ", /*pop*/ " +
+        std::to_string(rule.right().size());
+
+    auto k = finder(actions, rule);
+    if (k && !(*k).special) {
+        std::vector<std::string> signature;
+        make_signature(
+            nonterminal_types,
+            rule,
+            *k,
+            signature,
+            options.smart_pointer_tag);
+        for (const auto& x: (*k).source_indices) {
+            args += ", " + std::to_string(x);
+        }
+        return "call_" + std::to_string(stub_indices.at(signature)) + "_" +
+            normalize_internal_sa_name(signature[0]) + args + ")";
+    }
+    return (k ? (*k).name : std::string("call_nothing")) + args + ")";
+}
+
+// the reductions of a state, the cases reducing by the same call sharing
+// it.  with --default-reductions the most frequent call becomes the
+// default of the state's switch in place of the syntax error, as in the
+// table driver: a token in error is then caught by the next state that
+// shifts.  a consistent state, doing nothing but that reduction, reduces
+// without looking at the token.  off by default, since post() rolls those
+// reductions back on an error after their semantic actions have run
+struct state_reductions {
+    std::vector<std::string>                        calls; // but the default
+    std::map<std::string, std::vector<std::string>> cases;
+    std::string                                     default_call; // or empty
+    bool                                            consistent;
+};
+
+void collect_reductions(
+    state_reductions&                               r,
+    const GenerateOptions&                          options,
+    const std::map<std::string, Type>&              nonterminal_types,
+    const std::vector<std::string>&                 tokens,
+    const action_map_type&                          actions,
+    const tgt::compact_table&                       table,
+    const tgt::compact_table::state&                state,
+    const std::map<std::vector<std::string>, int>&  stub_indices) {
+
+    size_t reduces = 0;
+    size_t most = 0;
+    for (const auto& pair: state.action_table) {
+        const auto& action = pair.second;
+        if (action.type != zw::gr::action_reduce) { continue; }
+        if (options.glr &&
+            state.alternative_table.find(pair.first) !=
+            state.alternative_table.end()) {
+            continue; // forks, see emit_state_functions
+        }
+
+        std::string call = reduce_call(
+            options, nonterminal_types, actions,
+            table.rule(action), stub_indices);
+        auto& cases = r.cases[call];
+        if (cases.empty()) { r.calls.push_back(call); }
+        cases.push_back(options.token_prefix + tokens[pair.first]);
+        if (most < cases.size()) {
+            r.default_call = call;
+            most = cases.size();
+        }
+        reduces++;
+    }
+    if (!options.default_reductions) {
+        r.default_call.clear();
+        r.consistent = false;
+        return;
+    }
+    r.calls.erase(
+        std::remove(r.calls.begin(), r.calls.end(), r.default_call),
+        r.calls.end());
+    r.consistent =
+        r.calls.empty() && reduces != 0 &&
+        reduces == state.action_table.size();
+}
+
+// gotof(state, nonterminal): the goto table packed by nonterminal column,
+// with the most frequent state of a column as its default
+void emit_gotof(
+    std::ostream&                                   os,
+    const std::map<std::string, Type>&              nonterminal_types,
+    const tgt::compact_table&                       table) {
+
+    std::map<std::string, int> nonterminal_indices;
+    for (const auto& x: nonterminal_types) {
+        int n = int(nonterminal_indices.size());
+        nonterminal_indices[x.first] = n;
+    }
+
+    std::vector<sparse_row> goto_columns(nonterminal_indices.size());
+    for (const auto& state: table.states()) {
+        for (const auto& pair: state.goto_table) {
+            goto_columns[nonterminal_indices.at(pair.first.name())]
+                .push_back(std::make_pair(state.no, pair.second));
+        }
+    }
+
+    std::vector<int> default_gotos;
+    for (auto& column: goto_columns) {
+        default_gotos.push_back(
+            take_default(column, 0, [](int) { return true; }));
+    }
+
+    packed_rows packed_gotos;
+    pack_rows(packed_gotos, goto_columns, int(table.states().size()));
+
+    stencil(
+        os, R"(
+    static int gotof(int state, Nonterminal nonterminal) {
+$${goto_arrays}
+        int i = base[nonterminal] + state;
+        return check[i] == base[nonterminal] ?
+            next[i] : default_goto[nonterminal];
+    }
+
+)",
+        {"goto_arrays", [&](std::ostream& os) {
+                emit_array(os, "base", packed_gotos.base);
+                emit_array(os, "check", packed_gotos.check);
+                emit_array(os, "next", packed_gotos.value);
+                emit_array(os, "default_goto", default_gotos);
+            }}
+        );
+}
+
+// handle_error(state), whether recovery may stop popping at the state
+void emit_handle_error(
+    std::ostream&                                   os,
+    const GenerateOptions&                          options,
+    const tgt::compact_table&                       table) {
+
+    if (!options.recovery) { return; }
+    os << "    static bool handle_error(int state) {\n"
+       << "        static constexpr bool handle[] = {";
+    size_t i = 0;
+    for (const auto& state: table.states()) {
+        os << (i++ % 8 == 0 ? "\n            " : " ")
+           << (state.handle_error ? "true" : "false") << ",";
+    }
+    os << "\n        };\n"
+       << "        return handle[state];\n"
+       << "    }\n\n";
+}
+
+// one member function per state, dispatched through the entry table
+void emit_state_functions(
+    std::ostream&                                   os,
+    const GenerateOptions&                          options,
+    const std::map<std::string, Type>&              nonterminal_types,
+    const std::vector<std::string>&                 tokens,
+    const action_map_type&                          actions,
+    const tgt::compact_table&                       table,
+    const std::map<std::vector<std::string>, int>&  stub_indices) {
+
+    // states handler
+    for (const auto& state: table.states()) {
+        state_reductions reductions;
+        collect_reductions(
+            reductions, options, nonterminal_types, tokens, actions, table,
+            state, stub_indices);
+
+        // state header
+        stencil(
+            os, R"(
+    bool state_${state_no}(token_type${token}, value_type&${value}) {
+$${debmes:state}
+)",
+            {"state_no", state.no},
+            {"token",
+             !reductions.consistent || options.debug_parser ? " token" : ""},
+            {"value", !reductions.consistent ? " value" : ""},
+            {"debmes:state", [&](std::ostream& os){
+                    if (options.debug_parser) {
+                        stencil(
+                            os, R"(
+        std::cerr << "state_${state_no} << " << token_label(token) << "\n";
+)",
+                            {"state_no", state.no}
+                            );
+                    }}}
+            );
+
+        if (reductions.consistent) {
+            stencil(
+                os, R"(
+        // reduce
+        return ${call};
+    }
+
+)",
+                {"call", reductions.default_call}
+                );
+            continue;
+        }
+
+        stencil(
+            os, R"(
+        switch(token) {
+)"
+            );
+
+        // action table
+        for (const auto& pair: state.action_table) {
+            const auto& token = pair.first;
+            const auto& action = pair.second;
+
+            // action header 
+            std::string case_tag = options.token_prefix + tokens[token];
+
+            // a conflict cell forks the branches (-glr)
+            if (options.glr &&
+                state.alternative_table.find(token) !=
+                state.alternative_table.end()) {
+                stencil(
+                    os, R"(
+        case ${case_tag}:
+            // fork
+            return glr_fork(token, value);
+)",
+                    {"case_tag", case_tag}
+                    );
+                continue;
+            }
+
+            // action
+            switch (action.type) {
+                case zw::gr::action_shift:
+                    stencil(
+                        os, R"(
+        case ${case_tag}:
+            // shift
+            push_stack(/*state*/ ${dest_index}, std::move(value));
+            return false;
+)",
+                        {"case_tag", case_tag},
+                        {"dest_index", action.dest_index}
+                        );
+                    break;
+                case zw::gr::action_reduce:
+                    break;
+                case zw::gr::action_accept:
+                    stencil(
+                        os, R"(
+        case ${case_tag}:
+            // accept
+            accepted_ = true;
+            accepted_value_ = get_arg(1, 0);
+            return false;
+)",
+                        {"case_tag", case_tag}
+                        );
+                    break;
+                case zw::gr::action_error:
+                    stencil(
+                        os, R"(
+        case ${case_tag}:
+            sa_.syntax_error();
+            error_ = true;
+            return false;
+)",
+                        {"case_tag", case_tag}
+                        );
+                    break;
+            }
+
+            // action footer
+        }
+
+        // reductions
+        for (const auto& call: reductions.calls) {
+            for (const auto& case_tag: reductions.cases[call]) {
+                // fall through, be aware when port to other language
+                stencil(
+                    os, R"(
+        case ${case_tag}:
+)",
+                    {"case_tag", case_tag}
+                    );
+            }
+            stencil(
+                os, R"(
+            // reduce
+            return ${call};
+)",
+                {"call", call}
+                );
+        }
+
+        // dispatcher footer / state footer
+        if (!reductions.default_call.empty()) {
+            stencil(
+                os, R"(
+        default:
+            // reduce
+            return ${call};
+        }
+    }
+
+)",
+                {"call", reductions.default_call}
+                );
+        } else {
+            stencil(
+                os, R"(
+        default:
+            sa_.syntax_error();
+            error_ = true;
+            return false;
+        }
+    }
+
+)"
+                );
+        }
+    }
+
+    // table, defined after the class by emit_state_table
+    stencil(
+        os, R"(
+    static const table_entry entries_[];
+
+    const table_entry* entry(int n) const {
+        return &entries_[n];
+    }
+
+$${gotof}
+)",
+        {"gotof", [&](std::ostream& os) {
+                emit_gotof(os, nonterminal_types, table);
+            }}
+        );
+}
+
+// the entries of the state functions, a constant-initialized static
+// member shared by all the parsers rather than a function-local static
+// behind an initialization guard
+void emit_state_table(
+    std::ostream&                                   os,
+    const GenerateOptions&                          options,
+    const tgt::compact_table&                       table) {
+
+    stencil(
+        os, R"(
+template <${token_parameter}${value_parameter}class _SemanticAction,
+          unsigned int _StackSize>
+const typename Parser<${token_argument}${value_argument}_SemanticAction, _StackSize>::table_entry
+Parser<${token_argument}${value_argument}_SemanticAction, _StackSize>::entries_[] = {
+$${entries}
+};
+
+)",
+        {"token_parameter", options.external_token ? "class _Token, " : ""},
+        {"token_argument", options.external_token ? "_Token, " : ""},
+        {"value_parameter", options.typed_stack ? "" : "class _Value, "},
+        {"value_argument", options.typed_stack ? "" : "_Value, "},
+        {"entries", [&](std::ostream& os) {
+                int i = 0;
+                for (const auto& state: table.states()) {
+                    stencil(
+                        os, R"(
+    { &Parser::state_${i}, ${i}, ${handle_error} },
+)",
+                        {"i", i},
+                        {"handle_error", state.handle_error}
+                        );
+                    ++i;
+                }
+            }}
+        );
+}
+
+// table driven (-table): the actions and gotos packed in constant arrays,
+// run by one loop
+void emit_table_driver(
+    std::ostream&                                   os,
+    const GenerateOptions&                          options,
+    const std::map<std::string, Type>&              nonterminal_types,
+    const std::vector<std::string>&                 tokens,
+    const action_map_type&                          actions,
+    const tgt::compact_table&                       table,
+    const std::map<std::vector<std::string>, int>&  stub_indices) {
+
+    // actions: 0 error, 1..N shift to state - 1, N + 1 accept, negative
+    // reduce by reduction -action - 1
+    int state_count = int(table.states().size());
+    int accept_action = state_count + 1;
+
+    std::vector<std::string> reductions;
+    std::map<std::string, int> reduction_indices;
+
+    std::vector<sparse_row> action_rows;
+    std::vector<int> default_actions;
+    for (const auto& state: table.states()) {
+        sparse_row row;
+        for (const auto& pair: state.action_table) {
+            const auto& action = pair.second;
+            int x = 0;
+            switch (action.type) {
+                case zw::gr::action_shift:
+                    x = action.dest_index + 1;
+                    break;
+                case zw::gr::action_reduce: {
+                    std::string call = reduce_call(
+                        options, nonterminal_types, actions,
+                        table.rule(action), stub_indices);
+                    auto r = reduction_indices.find(call);
+                    if (r == reduction_indices.end()) {
+                        r = reduction_indices.insert(
+                            std::make_pair(call, int(reductions.size())))
+                            .first;
+                        reductions.push_back(call);
+                    }
+                    x = -(*r).second - 1;
+                }
+                    break;
+                case zw::gr::action_accept:
+                    x = accept_action;
+                    break;
+                case zw::gr::action_error:
+                    x = 0;
+                    break;
+            }
+            row.push_back(std::make_pair(pair.first, x));
+        }
+
+        // default reduction (--default-reductions): the most frequent
+        // one, otherwise error.  without it a bad token is caught before
+        // any reduction, as in the switch mode
+        default_actions.push_back(
+            options.default_reductions ?
+            take_default(row, 0, [](int x) { return x < 0; }) :
+            take_default(row, 0, [](int) { return false; }));
+        action_rows.push_back(row);
+    }
+
+    // external tokens caper doesn't know take the column past the last
+    packed_rows packed_actions;
+    pack_rows(
+        packed_actions,
+        action_rows,
+        int(tokens.size()) + (options.external_token ? 1 : 0));
+
+    stencil(
+        os, R"(
+    static int token_index(token_type token) {
+$${token_index}
+    }
+
+    static int action_of(int state, int token) {
+$${action_arrays}
+        int i = base[state] + token;
+        return check[i] == base[state] ? action[i] : default_action[state];
+    }
+
+$${gotof}
+$${handle_error}
+    bool reduce(int reduction) {
+        switch(reduction) {
+$${reductions}
+        default: assert(0); return false;
+        }
+    }
+
+    bool step(token_type token, value_type& value) {
+        int state = stack_top()->state;
+$${debmes:state}
+        int action = action_of(state, token_index(token));
+        if (0 < action && action <= ${state_count}) {
+            // shift
+            push_stack(/*state*/ action - 1, std::move(value));
+            return false;
+        }
+        if (action < 0) {
+            // reduce
+            return reduce(-action - 1);
+        }
+        if (action == ${accept_action}) {
+            // accept
+            accepted_ = true;
+            accepted_value_ = get_arg(1, 0);
+            return false;
+        }
+        sa_.syntax_error();
+        error_ = true;
+        return false;
+    }
+
+)",
+        {"token_index", [&](std::ostream& os) {
+                if (!options.external_token) {
+                    os << "        return int(token);\n";
+                    return;
+                }
+                os << "        switch(token) {\n";
+                for (size_t i = 0 ; i < tokens.size() ; i++) {
+                    os << "        case " << options.token_prefix
+                       << tokens[i] << ": return " << i << ";\n";
+                }
+                os << "        default: return " << tokens.size() << ";\n"
+                   << "        }\n";
+            }},
+        {"action_arrays", [&](std::ostream& os) {
+                emit_array(os, "base", packed_actions.base);
+                emit_array(os, "check", packed_actions.check);
+                emit_array(os, "action", packed_actions.value);
+                emit_array(os, "default_action", default_actions);
+            }},
+        {"gotof", [&](std::ostream& os) {
+                emit_gotof(os, nonterminal_types, table);
+            }},
+        {"handle_error", [&](std::ostream& os) {
+                emit_handle_error(os, options, table);
+            }},
+        {"reductions", [&](std::ostream& os) {
+                for (size_t i = 0 ; i < reductions.size() ; i++) {
+                    stencil(
+                        os, R"(
+        case ${index}: return ${call};
+)",
+                        {"index", i},
+                        {"call", reductions[i]}
+                        );
+                }
+            }},
+        {"debmes:state", [&](std::ostream& os) {
+                if (options.debug_parser) {
+                    stencil(
+                        os, R"(
+        std::cerr << "state_" << state << " << " << token_label(token) << "\n";
+)"
+                        );
+                }
+            }},
+        {"state_count", state_count},
+        {"accept_action", accept_action}
+        );
+}
+
+// computed goto (-goto): all the states in one function, each a label
+// dispatched through a label table under GCC and Clang, through a switch
+// elsewhere
+void emit_goto_machine(
+    std::ostream&                                   os,
+    const GenerateOptions&                          options,
+    const std::map<std::string, Type>&              nonterminal_types,
+    const std::vector<std::string>&                 tokens,
+    const action_map_type&                          actions,
+    const tgt::compact_table&                       table,
+    const std::map<std::vector<std::string>, int>&  stub_indices) {
+
+    stencil(
+        os, R"(
+$${gotof}
+$${handle_error}
+    struct no_lexer {};
+
+    // the token after a shift, pulled from lexer; none when posted
+    template <class Lexer>
+    static bool next_token(Lexer& lexer, token_type& token, value_type& value) {
+        token = lexer(value);
+        return true;
+    }
+
+    static bool next_token(no_lexer&, token_type&, value_type&) {
+        return false;
+    }
+
+    bool step(token_type token, value_type& value) {
+        no_lexer lexer;
+        return run(lexer, token, value);
+    }
+
+    // runs token through its reductions and its shift, then on through the
+    // tokens lexer gives, until accepted or an error.  token and value are
+    // then the token that stopped it
+    template <class Lexer>
+    bool run(Lexer& lexer, token_type& token, value_type& value) {
+#if defined(__GNUC__)
+        static void* const states[] = {
+$${labels}
+        };
+#endif
+
+    dispatch:
+#if defined(__GNUC__)
+        goto *states[stack_top()->state];
+#else
+        switch(stack_top()->state) {
+$${cases}
+        default: assert(0); return false;
+        }
+#endif
+
+)",
+        {"gotof", [&](std::ostream& os) {
+                emit_gotof(os, nonterminal_types, table);
+            }},
+        {"handle_error", [&](std::ostream& os) {
+                emit_handle_error(os, options, table);
+            }},
+        {"labels", [&](std::ostream& os) {
+                for (const auto& state: table.states()) {
+                    stencil(
+                        os, R"(
+            &&state_${state_no},
+)",
+                        {"state_no", state.no}
+                        );
+                }
+            }},
+        {"cases", [&](std::ostream& os) {
+                for (const auto& state: table.states()) {
+                    stencil(
+                        os, R"(
+        case ${state_no}: goto state_${state_no};
+)",
+                        {"state_no", state.no}
+                        );
+                }
+            }}
+        );
+
+    for (const auto& state: table.states()) {
+        state_reductions reductions;
+        collect_reductions(
+            reductions, options, nonterminal_types, tokens, actions, table,
+            state, stub_indices);
+
+        stencil(
+            os, R"(
+    state_${state_no}:
+$${debmes:state}
+)",
+            {"state_no", state.no},
+            {"debmes:state", [&](std::ostream& os){
+                    if (options.debug_parser) {
+                        stencil(
+                            os, R"(
+        std::cerr << "state_${state_no} << " << token_label(token) << "\n";
+)",
+                            {"state_no", state.no}
+                            );
+                    }}}
+            );
+
+        if (reductions.consistent) {
+            stencil(
+                os, R"(
+        // reduce
+        if (!${call}) { return false; }
+        goto dispatch;
+
+)",
+                {"call", reductions.default_call}
+                );
+            continue;
+        }
+
+        stencil(
+            os, R"(
+        switch(token) {
+)"
+            );
+
+        for (const auto& pair: state.action_table) {
+            const auto& action = pair.second;
+            std::string case_tag = options.token_prefix + tokens[pair.first];
+
+            switch (action.type) {
+                case zw::gr::action_shift:
+                    stencil(
+                        os, R"(
+        case ${case_tag}:
+            // shift
+            if (!push_stack(/*state*/ ${dest_index}, std::move(value)) ||
+                !next_token(lexer, token, value)) {
+                return false;
+            }
+            goto state_${dest_index};
+)",
+                        {"case_tag", case_tag},
+                        {"dest_index", action.dest_index}
+                        );
+                    break;
+                case zw::gr::action_reduce:
+                    break;
+                case zw::gr::action_accept:
+                    stencil(
+                        os, R"(
+        case ${case_tag}:
+            // accept
+            accepted_ = true;
+            accepted_value_ = get_arg(1, 0);
+            return false;
+)",
+                        {"case_tag", case_tag}
+                        );
+                    break;
+                case zw::gr::action_error:
+                    stencil(
+                        os, R"(
+        case ${case_tag}:
+            sa_.syntax_error();
+            error_ = true;
+            return false;
+)",
+                        {"case_tag", case_tag}
+                        );
+                    break;
+            }
+        }
+
+        for (const auto& call: reductions.calls) {
+            for (const auto& case_tag: reductions.cases[call]) {
+                stencil(
+                    os, R"(
+        case ${case_tag}:
+)",
+                    {"case_tag", case_tag}
+                    );
+            }
+            stencil(
+                os, R"(
+            // reduce
+            if (!${call}) { return false; }
+            goto dispatch;
+)",
+                {"call", call}
+                );
+        }
+
+        if (!reductions.default_call.empty()) {
+            stencil(
+                os, R"(
+        default:
+            // reduce
+            if (!${call}) { return false; }
+            goto dispatch;
+        }
+
+)",
+                {"call", reductions.default_call}
+                );
+        } else {
+            stencil(
+                os, R"(
+        default:
+            sa_.syntax_error();
+            error_ = true;
+            return false;
+        }
+
+)"
+                );
+        }
+    }
+
+    stencil(
+        os, R"(
+    }
+
+)"
+        );
+}
+
+// Value (%typed_stack): the value of a stack frame, empty or one of the
+// types of the grammar's symbols, as a tagged union.  It stands for the
+// user's value type and its downcast/upcast, so the semantic actions
+// take and return their own types, unboxed
+void emit_value_class(
+    std::ostream&                                   os,
+    const GenerateOptions&                          options,
+    const std::map<std::string, Type>&              terminal_types,
+    const std::map<std::string, Type>&              nonterminal_types) {
+
+    std::vector<std::string> types;
+    auto add = [&](const Type& x) {
+        if (x.name.empty() || x.name == "$error" ||
+            x.extension != Extension::None) {
+            return;
+        }
+        std::string type = make_type_name(x, options.smart_pointer_tag);
+        if (std::find(types.begin(), types.end(), type) == types.end()) {
+            types.push_back(type);
+        }
+    };
+    for (const auto& x: terminal_types) { add(x.second); }
+    for (const auto& x: nonterminal_types) { add(x.second); }
+
+    // alternative i + 1 of types, to stencil per alternative
+    auto each = [&](const char* s) {
+        return [&types, s](std::ostream& os) {
+            for (size_t i = 0 ; i < types.size() ; i++) {
+                stencil(
+                    os, s,
+                    {"n", i + 1},
+                    {"type", types[i]}
+                    );
+            }
+        };
+    };
+
+    stencil(
+        os, R"(
+class Value {
+$${typedefs}
+public:
+    Value() : tag_(0) {}
+    Value(const Value& x) : tag_(0) { assign(x); }
+    Value(Value&& x) : tag_(0) { assign(std::move(x)); }
+$${constructors}
+    ~Value() { clear(); }
+
+    Value& operator=(const Value& x) {
+        if (this != &x) { clear(); assign(x); }
+        return *this;
+    }
+    Value& operator=(Value&& x) {
+        if (this != &x) { clear(); assign(std::move(x)); }
+        return *this;
+    }
+
+    // an empty value gives T()
+$${downcasts}
+private:
+    void clear() {
+        switch (tag_) {
+$${destroy}
+        }
+        tag_ = 0;
+    }
+
+    void assign(const Value& x) {
+        switch (x.tag_) {
+$${copy}
+        }
+        tag_ = x.tag_;
+    }
+
+    void assign(Value&& x) {
+        switch (x.tag_) {
+$${move}
+        }
+        tag_ = x.tag_;
+    }
+
+    int tag_;
+    union U {
+        U() {}
+        ~U() {}
+$${members}
+    } u_;
+
+};
+
+)",
+        {"typedefs", each(R"(
+    typedef ${type} type_${n};
+)")},
+        {"constructors", each(R"(
+    Value(const type_${n}& x) : tag_(${n}) { new (&u_.v${n}) type_${n}(x); }
+    Value(type_${n}&& x) : tag_(${n}) { new (&u_.v${n}) type_${n}(std::move(x)); }
+)")},
+        {"downcasts", each(R"(
+    static void downcast(type_${n}& x, const Value& v) {
+        assert(v.tag_ == ${n} || v.tag_ == 0);
+        x = v.tag_ == ${n} ? v.u_.v${n} : type_${n}();
+    }
+    static void downcast(type_${n}& x, Value&& v) {
+        assert(v.tag_ == ${n} || v.tag_ == 0);
+        x = v.tag_ == ${n} ? std::move(v.u_.v${n}) : type_${n}();
+    }
+)")},
+        {"destroy", each(R"(
+        case ${n}: u_.v${n}.~type_${n}(); break;
+)")},
+        {"copy", each(R"(
+        case ${n}: new (&u_.v${n}) type_${n}(x.u_.v${n}); break;
+)")},
+        {"move", each(R"(
+        case ${n}: new (&u_.v${n}) type_${n}(std::move(x.u_.v${n})); break;
+)")},
+        {"members", each(R"(
+        type_${n} v${n};
+)")}
+        );
+}
+
+// the GLR branches (-glr).  a conflict cell of the state functions forks:
+// the parser goes on in a graph-structured stack over the frames below
+// the fork, with the actions of the table and the ones the conflicts
+// resolved away, and goes back to the frames once a single branch is
+// left.  a reduction in the branches calls the semantic action at once
+// with copies of the values; deriving a symbol over a span already
+// derived keeps the first value.  the branches go in the order of the
+// actions, the table's own first
+void emit_glr(
+    std::ostream&                                   os,
+    const GenerateOptions&                          options,
+    const std::map<std::string, Type>&              nonterminal_types,
+    const std::vector<std::string>&                 tokens,
+    const action_map_type&                          actions,
+    const tgt::compact_table&                       table) {
+
+    const auto& g = table.get_grammar();
+
+    // who converts the values, as in generate_cpp
+    std::string downcast = options.typed_stack ?
+        "Value::downcast" : "sa_.downcast";
+
+    stencil(
+        os, R"(
+    bool step(token_type token, value_type& value) {
+        if (glr_) { return glr_step(token, value); }
+        return (this->*(stack_top()->entry->state))(token, value);
+    }
+
+    struct glr_node;
+
+    struct glr_link {
+        glr_node*   below;
+        value_type  value;      // of the symbol from below to the node
+    };
+
+    struct glr_node {
+        int                     state;
+        int                     floor;      // frames below, or -1
+        std::vector<glr_link>   links;
+        bool                    reduced;    // by the current token
+    };
+
+    // a node with a floor stands for the frames [0, floor), and has no
+    // links.  the nodes live until the branches are left
+    bool                        glr_;
+    std::deque<glr_node>        glr_nodes_;
+    std::vector<glr_node*>      glr_tops_;
+    std::map<int, glr_node*>    glr_floors_;
+
+    struct glr_action {
+        token_type  token;
+        int         type;   // 0: shift, 1: reduce, 2: accept
+        int         arg;    // state to shift to, or rule
+    };
+
+    struct glr_path {
+        glr_node*               base;
+        int                     rule;
+        std::vector<value_type> args;
+    };
+
+    void glr_clear() {
+        glr_ = false;
+        glr_nodes_.clear();
+        glr_tops_.clear();
+        glr_floors_.clear();
+    }
+
+    glr_node* glr_new_node(int state) {
+        glr_nodes_.push_back(glr_node());
+        glr_node* n = &glr_nodes_.back();
+        n->state = state;
+        n->floor = -1;
+        n->reduced = false;
+        return n;
+    }
+
+    glr_node* glr_floor(int floor) {
+        glr_node*& n = glr_floors_[floor];
+        if (!n) {
+            n = glr_new_node(stack_.nth(floor - 1).entry->state_no);
+            n->floor = floor;
+        }
+        return n;
+    }
+
+    bool glr_fork(token_type token, value_type& value) {
+        glr_clear();
+        glr_ = true;
+        glr_tops_.push_back(glr_floor(int(stack_.depth())));
+        return glr_step(token, value);
+    }
+
+    // the token in all the branches.  the branches are left as they were
+    // if none of them takes it
+    bool glr_step(token_type token, value_type& value) {
+        size_t top_count = glr_tops_.size();
+        std::vector<size_t> link_counts;
+        for (glr_node* t: glr_tops_) {
+            link_counts.push_back(t->links.size());
+            t->reduced = false;
+        }
+
+        for (size_t i = 0 ; i < glr_tops_.size() ; i++) {
+            glr_reduce(glr_tops_[i], token, 0, 0);
+        }
+
+        std::vector<glr_node*> next;
+        for (glr_node* t: glr_tops_) {
+            const glr_action* a;
+            const glr_action* e;
+            glr_actions(t->state, a, e);
+            for (; a != e ; ++a) {
+                if (a->token != token) { continue; }
+                if (a->type == 0) {
+                    glr_node* n = 0;
+                    for (glr_node* x: next) {
+                        if (x->state == a->arg) { n = x; break; }
+                    }
+                    if (!n) {
+                        n = glr_new_node(a->arg);
+                        next.push_back(n);
+                    }
+                    glr_link l = { t, value };
+                    n->links.push_back(l);
+                } else if (a->type == 2) {
+                    accepted_ = true;
+                    accepted_value_ = 0 <= t->floor ?
+                        stack_.nth(t->floor - 1).value : t->links[0].value;
+                    return false;
+                }
+            }
+        }
+
+        if (next.empty()) {
+            glr_tops_.resize(top_count);
+            for (size_t i = 0 ; i < top_count ; i++) {
+                std::vector<glr_link>& links = glr_tops_[i]->links;
+                links.erase(links.begin() + link_counts[i], links.end());
+            }
+            if (top_count == 1 && 0 <= glr_tops_[0]->floor) {
+                glr_clear(); // not forked yet
+            }
+            sa_.syntax_error();
+            error_ = true;
+            return false;
+        }
+
+        glr_tops_.swap(next);
+        if (glr_tops_.size() == 1) {
+            glr_node* n = glr_tops_[0];
+            while (n->floor < 0 && n->links.size() == 1) {
+                n = n->links[0].below;
+            }
+            if (0 <= n->floor) { glr_collapse(glr_tops_[0]); }
+        }
+        return false;
+    }
+
+    // the reductions of n by token.  only the paths through the link k of
+    // m if m is given, as the other ones have been taken already
+    void glr_reduce(glr_node* n, token_type token, glr_node* m, size_t k) {
+        if (!m) { n->reduced = true; }
+
+        // all the paths first: the reductions may add links to the nodes
+        std::vector<glr_path> paths;
+        const glr_action* a;
+        const glr_action* e;
+        glr_actions(n->state, a, e);
+        for (; a != e ; ++a) {
+            if (a->token != token || a->type != 1) { continue; }
+            int length;
+            Nonterminal nonterminal;
+            glr_rule(a->arg, length, nonterminal);
+            glr_path p;
+            p.rule = a->arg;
+            p.args.resize(length);
+            glr_paths(paths, p, n, length, m, k, !m);
+        }
+
+        for (auto& p: paths) {
+            int length;
+            Nonterminal nonterminal;
+            glr_rule(p.rule, length, nonterminal);
+            value_type v;
+            glr_value(p.rule, p.args, v);
+            glr_join(p.base, gotof(p.base->state, nonterminal), v, token);
+        }
+    }
+
+    void glr_paths(
+        std::vector<glr_path>& paths, glr_path& p, glr_node* n, int length,
+        glr_node* m, size_t k, bool through) {
+        if (length == 0) {
+            if (through) {
+                p.base = n;
+                paths.push_back(p);
+            }
+            return;
+        }
+        if (0 <= n->floor) {
+            if (!through) { return; }
+            for (int i = 0 ; i < length ; i++) {
+                p.args[length - 1 - i] = stack_.nth(n->floor - 1 - i).value;
+            }
+            p.base = glr_floor(n->floor - length);
+            paths.push_back(p);
+            return;
+        }
+        for (size_t i = 0 ; i < n->links.size() ; i++) {
+            p.args[length - 1] = n->links[i].value;
+            glr_paths(
+                paths, p, n->links[i].below, length - 1, m, k,
+                through || (n == m && i == k));
+        }
+    }
+
+    // the node of state over base made by a reduction, merged into the
+    // branch of the same state if any
+    void glr_join(glr_node* base, int state, value_type& v, token_type token) {
+        for (size_t i = 0 ; i < glr_tops_.size() ; i++) {
+            glr_node* t = glr_tops_[i];
+            if (t->state != state || 0 <= t->floor) { continue; }
+
+            for (const auto& l: t->links) {
+                if (l.below == base) { return; } // ambiguous, keeps the first
+            }
+            glr_link l = { base, v };
+            t->links.push_back(l);
+
+            // the paths through the new link
+            size_t k = t->links.size() - 1;
+            for (size_t j = 0 ; j < glr_tops_.size() ; j++) {
+                if (glr_tops_[j]->reduced) {
+                    glr_reduce(glr_tops_[j], token, t, k);
+                }
+            }
+            return;
+        }
+
+        glr_node* n = glr_new_node(state);
+        glr_link l = { base, v };
+        n->links.push_back(l);
+        glr_tops_.push_back(n);
+    }
+
+    // leaves the branches for the frames of the one down from n, by the
+    // first links
+    void glr_collapse(glr_node* n) {
+        std::vector<glr_node*> branch;
+        while (n->floor < 0) {
+            branch.push_back(n);
+            n = n->links[0].below;
+        }
+        pop_stack(stack_.depth() - n->floor);
+        for (size_t i = branch.size() ; 0 < i ; i--) {
+            glr_node* x = branch[i - 1];
+            if (!push_stack(x->state, std::move(x->links[0].value))) {
+                break;
+            }
+        }
+        glr_clear();
+    }
+
+    // the actions of a state, the one of the table first for a token
+    static void glr_actions(
+        int state, const glr_action*& b, const glr_action*& e) {
+        static constexpr glr_action actions[] = {
+$${glr_actions}
+        };
+$${glr_rows}
+        b = actions + rows[state];
+        e = actions + rows[state + 1];
+    }
+
+    static void glr_rule(int rule, int& length, Nonterminal& nonterminal) {
+$${glr_lengths}
+        static constexpr Nonterminal left[] = {
+$${glr_lefts}
+        };
+        length = lengths[rule];
+        nonterminal = left[rule];
+    }
+
+    // the value of a reduction by rule, from the values of its right side
+    void glr_value(int rule, std::vector<value_type>& args, value_type& v) {
+        switch (rule) {
+$${glr_calls}
+        default:
+            v = value_type();
+            break;
+        }
+    }
+
+)",
+        {"glr_actions", [&](std::ostream& os) {
+                for (const auto& state: table.states()) {
+                    auto entry = [&](int token, const tgt::compact_table::action& a) {
+                        int type =
+                            a.type == zw::gr::action_shift ? 0 :
+                            a.type == zw::gr::action_reduce ? 1 : 2;
+                        int arg =
+                            type == 0 ? a.dest_index :
+                            type == 1 ? a.rule_index : 0;
+                        os << "            { " << options.token_prefix
+                           << tokens[token] << ", " << type << ", " << arg
+                           << " },\n";
+                    };
+                    for (const auto& pair: state.action_table) {
+                        if (pair.second.type == zw::gr::action_error) {
+                            continue;
+                        }
+                        entry(pair.first, pair.second);
+                        for (const auto& y: state.alternative_table) {
+                            if (y.first == pair.first) {
+                                entry(y.first, y.second);
+                            }
+                        }
+                    }
+                }
+            }},
+        {"glr_rows", [&](std::ostream& os) {
+                std::vector<int> rows { 0 };
+                for (const auto& state: table.states()) {
+                    int n = 0;
+                    for (const auto& pair: state.action_table) {
+                        if (pair.second.type == zw::gr::action_error) {
+                            continue;
+                        }
+                        n++;
+                        for (const auto& y: state.alternative_table) {
+                            if (y.first == pair.first) { n++; }
+                        }
+                    }
+                    rows.push_back(rows.back() + n);
+                }
+                emit_array(os, "rows", rows);
+            }},
+        {"glr_lengths", [&](std::ostream& os) {
+                std::vector<int> lengths;
+                for (size_t i = 0 ; i < g.size() ; i++) {
+                    lengths.push_back(int(g.at(i).right().size()));
+                }
+                emit_array(os, "lengths", lengths);
+            }},
+        {"glr_lefts", [&](std::ostream& os) {
+                for (size_t i = 0 ; i < g.size() ; i++) {
+                    const auto& name = g.at(i).left().name();
+                    os << "            "
+                       << (nonterminal_types.count(name) ?
+                           "Nonterminal_" + name : "Nonterminal(0)")
+                       << ",\n";
+                }
+            }},
+        {"glr_calls", [&](std::ostream& os) {
+                for (size_t i = 0 ; i < g.size() ; i++) {
+                    const auto& rule = g.at(i);
+                    auto k = finder(actions, rule);
+                    if (!k) { continue; }
+                    const SemanticAction& sa = *k;
+                    if (sa.special) {
+                        // forward_unit, the only special action here
+                        stencil(
+                            os, R"(
+        case ${rule_index}:
+            v = std::move(args[0]);
+            break;
+)",
+                            {"rule_index", int(i)}
+                            );
+                        continue;
+                    }
+                    const auto& rule_type =
+                        *finder(nonterminal_types, rule.left().name());
+
+                    stencil(
+                        os, R"(
+        case ${rule_index}: {
+)",
+                        {"rule_index", int(i)}
+                        );
+                    for (size_t l = 0 ; l < sa.args.size() ; l++) {
+                        stencil(
+                            os, R"(
+            ${arg_type} arg${index}; ${downcast}(arg${index}, std::move(args[${source_index}]));
+)",
+                            {"arg_type", make_type_name(sa.args[l].type, options.smart_pointer_tag)},
+                            {"index", l},
+                            {"downcast", downcast},
+                            {"source_index", sa.source_indices[l]}
+                            );
+                    }
+                    stencil(
+                        os, R"(
+            ${nonterminal_type} r = sa_.${semantic_action_name}(${args});
+            ${upcast}
+            break;
+        }
+)",
+                        {"nonterminal_type", make_type_name(rule_type, options.smart_pointer_tag)},
+                        {"semantic_action_name", normalize_sa_call(sa.name)},
+                        {"upcast", options.typed_stack ?
+                            "v = value_type(std::move(r));" :
+                            "sa_.upcast(v, r);"},
+                        {"args", [&](std::ostream& os) {
+                                for (size_t l = 0 ; l < sa.args.size() ; l++) {
+                                    os << (l ? ", " : "") << "arg" << l;
+                                }
+                            }}
+                        );
+                }
+            }}
+        );
+}
+
 } // unnamed namespace
 
 void generate_cpp(
     const std::string&                  src_filename,
     std::ostream&                       os,
     const GenerateOptions&              options,
-    const std::map<std::string, Type>&,
+    const std::map<std::string, Type>&  terminal_types,
     const std::map<std::string, Type>&  nonterminal_types,
     const std::vector<std::string>&     tokens,
     const action_map_type&              actions,
-    const tgt::parsing_table&           table) {
+    const tgt::compact_table&           table) {
 
 #ifdef _WIN32
     char basename[_MAX_PATH];
@@ -119,6 +1550,13 @@ void generate_cpp(
     std::string filename = src_filename;
 #endif
 
+    if (options.glr && options.allow_ebnf) {
+        throw unsupported_feature("C++ GLR", "EBNF");
+    }
+    if (options.glr && options.dont_use_stl) {
+        throw unsupported_feature("C++ GLR", "dont_use_stl");
+    }
+
     std::string headername = filename;
     for (auto& x: headername){
         if (!isalpha(x) && !isdigit(x)) {
@@ -128,6 +1566,25 @@ void generate_cpp(
         }
     }
 
+    // how the parser steps and goes to, by member function pointers of
+    // the state, or by the state number (-table, -goto)
+    bool state_number = options.table_driven || options.computed_goto;
+    std::string step = state_number || options.glr ?
+        "step" : "(this->*(stack_top()->entry->state))";
+    std::string top_handles_error = state_number ?
+        "handle_error(stack_top()->state)" :
+        "stack_top()->entry->handle_error";
+    auto gotof = [&](const std::string& frame) {
+        return state_number ?
+            "gotof(" + frame + "->state, nonterminal)" :
+            "gotof(" + frame + "->entry->state_no, nonterminal)";
+    };
+
+    // who converts the values of the stack, the semantic action object,
+    // or Value itself (%typed_stack)
+    std::string downcast = options.typed_stack ?
+        "Value::downcast" : "sa_.downcast";
+
     // once header / notice / URL / includes / namespace header
     stencil(
         os, R"(
@@ -139,8 +1596,11 @@ void generate_cpp(
 
 #include <cstdlib>
 #include <cassert>
+#include <utility>
 $${debug_include}
+$${typed_include}
 $${use_stl}
+$${glr_include}
 
 namespace ${namespace_name} {
 
@@ -149,8 +1609,12 @@ namespace ${namespace_name} {
         {"headername", headername},
         {"debug_include",
             {options.debug_parser ? "#include <iostream>\n" : ""}},
+        {"typed_include",
+            {options.typed_stack ? "#include <new>\n" : ""}},
         {"use_stl",
-            {options.dont_use_stl ? "" : "#include <vector>\n"}},
+            {options.dont_use_stl ? "" : "#include <iterator>\n#include <vector>\n"}},
+        {"glr_include",
+            {options.glr ? "#include <deque>\n#include <map>\n" : ""}},
         {"namespace_name", options.namespace_name}
         );
 
@@ -204,98 +1668,160 @@ $${labels}
 template <class T, unsigned int StackSize>
 class Stack {
 public:
-    Stack() { gap_ = 0; }
+    // frames [0, gap_) are committed and untouched by the current
+    // transaction; committed frames popped by it are moved to undo_, top
+    // first, and moved back on rollback.  undo_ [0, base_) is the log of
+    // the snapshots, the same way: frames [0, level_.gap) are untouched
+    // since the newest snapshot, the ones it lost are in undo_
+    // [level_.undo, base_), and the older snapshots' are below
+    struct level {
+        size_t gap;
+        size_t undo;
+    };
+
+    Stack() { gap_ = 0; base_ = 0; level_.gap = 0; level_.undo = 0; }
 
     void rollback_tmp() {
+        rollback(gap_, base_);
         gap_ = stack_.size();
-        tmp_.clear();
     }
 
     void commit_tmp() {
-        // may throw
-        stack_.reserve(gap_ + tmp_.size());
-	   
-        // expect not to throw
-        stack_.erase(stack_.begin()+ gap_, stack_.end());
-        stack_.insert(stack_.end(), tmp_.begin(), tmp_.end());
-        tmp_.clear();
-    }
-    bool push(const T& f) {
+        merge(gap_, base_);
+        gap_ = stack_.size();
+        base_ = undo_.size();
+    }
+
+    // starts a snapshot of the committed frames, sharing them until they
+    // are popped; returns the level to give back to release
+    level snapshot() {
+        rollback_tmp();
+        level x = level_;
+        level_.gap = stack_.size();
+        level_.undo = base_;
+        return x;
+    }
+
+    // back to the newest snapshot, which is kept
+    void restore() {
+        rollback_tmp();
+        rollback(level_.gap, level_.undo);
+        level_.gap = gap_ = stack_.size();
+        base_ = undo_.size();
+    }
+
+    // forgets the newest snapshot, made with x, keeping the frames
+    void release(const level& x) {
+        rollback_tmp();
+        level y = level_;
+        level_ = x;
+        merge(y.gap, y.undo);
+        base_ = undo_.size();
+    }
+
+    template <class... A>
+    bool push(A&&... a) {
+        // arguments are left untouched if full
         if (StackSize != 0 &&
-            int(StackSize) <= int(stack_.size() + tmp_.size())) {
+            int(StackSize) <= int(stack_.size() + undo_.size())) {
             return false;
         }
-        tmp_.push_back(f);
+        stack_.emplace_back(std::forward<A>(a)...);
         return true;
     }
-	   
+
     void pop(size_t n) {
-        if (tmp_.size() < n) {
-            n -= tmp_.size();
-            tmp_.clear();
-            gap_ -= n;
-        } else {
-            tmp_.erase(tmp_.end() - n, tmp_.end());
+        size_t top = stack_.size() - n;
+        while (top < gap_) {
+            undo_.push_back(std::move(stack_[--gap_]));
         }
+        stack_.erase(stack_.begin() + top, stack_.end());
     }
 
     T& top() {
         assert(0 < depth());
-        if (!tmp_.empty()) {
-            return tmp_.back();
-        } else {
-            return stack_[gap_ - 1];
-        }
+        return stack_.back();
     }
-	   
+
     const T& get_arg(size_t base, size_t index) {
-        size_t n = tmp_.size();
-        if (base - index <= n) {
-            return tmp_[n - (base - index)];
-        } else {
-            return stack_[gap_ - (base - n) + index];
-        }
+        return stack_[stack_.size() - base + index];
+    }
+
+    T* uncommitted_arg(size_t base, size_t index) {
+        size_t i = stack_.size() - base + index;
+        return gap_ <= i ? &stack_[i] : nullptr;
     }
-	   
+
     void clear() {
         stack_.clear();
-        tmp_.clear();
-        gap_ = 0; 
+        undo_.clear();
+        gap_ = 0;
+        base_ = 0;
+        level_.gap = 0;
+        level_.undo = 0;
     }
-	   
+
     bool empty() const {
-        if (!tmp_.empty()) {
-            return false;
-        } else {
-            return gap_ == 0;
-        }
+        return stack_.empty();
     }
-	   
+
     size_t depth() const {
-        return gap_ + tmp_.size();
+        return stack_.size();
     }
-	   
+
     T& nth(size_t index) {
-        if (gap_ <= index) {
-            return tmp_[index - gap_];
-        } else {
-            return stack_[index];
-        }
+        return stack_[index];
+    }
+
+    // the top frame, to be changed in place
+    T* touch_top() {
+        touch(1);
+        return &stack_.back();
     }
 
-    void swap_top_and_second() {
+    bool swap_top_and_second() {
         int d = depth();
         assert(2 <= d);
-        T x = nth(d - 1);
-        nth(d - 1) = nth(d - 2);
-        nth(d - 2) = x;
+        touch(2);
+        T x = std::move(nth(d - 1));
+        nth(d - 1) = std::move(nth(d - 2));
+        nth(d - 2) = std::move(x);
+        return true;
     }
 
 private:
+    // the top n frames are to be changed in place; the committed ones
+    // among them are copied to undo_ first, as if popped
+    void touch(size_t n) {
+        size_t top = stack_.size() - n;
+        while (top < gap_) {
+            undo_.push_back(stack_[--gap_]);
+        }
+    }
+
+    // puts back the frames above gap logged in undo_ [undo, end)
+    void rollback(size_t gap, size_t undo) {
+        stack_.erase(stack_.begin() + gap, stack_.end());
+        while (undo < undo_.size()) {
+            stack_.push_back(std::move(undo_.back()));
+            undo_.pop_back();
+        }
+    }
+
+    // hands the log undo_ [undo, end), of the frames lost above gap, to
+    // level_; the ones above level_.gap were not there at its snapshot
+    void merge(size_t gap, size_t undo) {
+        size_t keep = gap < level_.gap ? level_.gap - gap : 0;
+        undo_.erase(undo_.begin() + undo, undo_.end() - keep);
+        if (gap < level_.gap) { level_.gap = gap; }
+    }
+
     std::vector<T> stack_;
-    std::vector<T> tmp_;
+    std::vector<T> undo_;
     size_t gap_;
-	   
+    size_t base_;
+    level level_;
+
 };
 
 )");
@@ -306,104 +1832,134 @@ private:
 template <class T, unsigned int StackSize>
 class Stack {
 public:
-    Stack() { top_ = 0; gap_ = 0; tmp_ = 0; }
-    ~Stack() {}
+    // frames [0, gap_) are committed and untouched by the current
+    // transaction; committed frames popped by it are moved to the undo
+    // log growing down from the end of the buffer, top first, and moved
+    // back on rollback.  the log entries [0, base_) are the snapshots',
+    // the same way: frames [0, level_.gap) are untouched since the newest
+    // snapshot, the ones it lost are the entries [level_.undo, base_),
+    // and the older snapshots' are below
+    struct level {
+        size_t gap;
+        size_t undo;
+    };
+
+    Stack() {
+        top_ = 0; gap_ = 0; undo_ = 0; base_ = 0;
+        level_.gap = 0; level_.undo = 0;
+    }
+    ~Stack() { clear(); }
 
     void rollback_tmp() {
-        for (size_t i = 0 ; i <tmp_ ; i++) {
-            at(StackSize - 1 - i).~T(); // explicit destructor
-        }
-        tmp_ = 0;
+        rollback(gap_, base_);
         gap_ = top_;
     }
 
     void commit_tmp() {
-        for (size_t i = 0 ; i <tmp_ ; i++) {
-            if (gap_ + i <top_) {
-                at(gap_ + i) = at(StackSize - 1 - i);
-            } else {
-                new (&at(gap_ + i)) T(at(StackSize - 1 - i));
-            }
-            at(StackSize - 1 - i).~T(); // explicit destructor
-        }
-        if (gap_ + tmp_ <top_) {
-            for (int i = 0 ; i <int(top_ - gap_ - tmp_); i++) {
-                at(top_ - 1 - i).~T(); // explicit destructor
-            }
-        }
+        merge(gap_, base_);
+        gap_ = top_;
+        base_ = undo_;
+    }
+
+    // starts a snapshot of the committed frames, sharing them until they
+    // are popped; returns the level to give back to release
+    level snapshot() {
+        rollback_tmp();
+        level x = level_;
+        level_.gap = top_;
+        level_.undo = base_;
+        return x;
+    }
+
+    // back to the newest snapshot, which is kept
+    void restore() {
+        rollback_tmp();
+        rollback(level_.gap, level_.undo);
+        level_.gap = gap_ = top_;
+        base_ = undo_;
+    }
 
-        top_ = gap_ = gap_ + tmp_;
-        tmp_ = 0;
+    // forgets the newest snapshot, made with x, keeping the frames
+    void release(const level& x) {
+        rollback_tmp();
+        level y = level_;
+        level_ = x;
+        merge(y.gap, y.undo);
+        base_ = undo_;
     }
 
-    bool push(const T& f) {
-        if (StackSize <= top_ + tmp_) { return false; }
-        new (&at(StackSize - 1 - tmp_++)) T(f);
+    template <class... A>
+    bool push(A&&... a) {
+        // arguments are left untouched if full
+        if (StackSize <= top_ + undo_) { return false; }
+        new (&at(top_)) T(std::forward<A>(a)...);
+        top_++;
         return true;
     }
 
     void pop(size_t n) {
-        size_t m = n; if (m > tmp_) { m = tmp_; }
-
-        for (size_t i = 0 ; i <m ; i++) {
-            at(StackSize - tmp_ + i).~T(); // explicit destructor
+        while (n--) {
+            if (--top_ < gap_) {
+                relocate(top_, StackSize - 1 - undo_++);
+                gap_ = top_;
+            } else {
+                at(top_).~T(); // explicit destructor
+            }
         }
-
-        tmp_ -= m;
-        gap_ -= n - m;
     }
 
     T& top() {
         assert(0 < depth());
-        if (0 <tmp_) {
-            return at(StackSize - 1 -(tmp_-1));
-        } else {
-            return at(gap_ - 1);
-        }
+        return at(top_ - 1);
     }
 
     const T& get_arg(size_t base, size_t index) {
-        if (base - index <= tmp_) {
-            return at(StackSize-1 - (tmp_ -(base - index)));
-        } else {
-            return at(gap_ -(base - tmp_) + index);
-        }
+        return at(top_ - base + index);
+    }
+
+    T* uncommitted_arg(size_t base, size_t index) {
+        size_t i = top_ - base + index;
+        return gap_ <= i ? &at(i) : 0;
     }
 
     void clear() {
-        rollback_tmp();
-        for (size_t i = 0 ; i <top_ ; i++) {
-            at(i).~T(); // explicit destructor
+        base_ = 0;
+        level_.gap = 0;
+        level_.undo = 0;
+        commit_tmp();
+        while (0 < top_) {
+            at(--top_).~T(); // explicit destructor
         }
-        top_ = gap_ = tmp_ = 0;
+        gap_ = 0;
     }
 
     bool empty() const {
-        if (0 < tmp_) {
-            return false;
-        } else {
-            return gap_ == 0;
-        }
+        return top_ == 0;
     }
 
     size_t depth() const {
-        return gap_ + tmp_;
+        return top_;
     }
 
     T& nth(size_t index) {
-        if (gap_ <= index) {
-            return at(StackSize-1 - (index - gap_));
-        } else {
-            return at(index);
-        }
+        return at(index);
+    }
+
+    // the top frame, to be changed in place; 0 if the undo log has no
+    // room for it
+    T* touch_top() {
+        return touch(1) ? &top() : 0;
     }
 
-    void swap_top_and_second() {
+    // false if the undo log has no room for the frames
+    bool swap_top_and_second() {
         int d = depth();
         assert(2 <= d);
-        T x = nth(d - 1);
-        nth(d - 1) = nth(d - 2);
-        nth(d - 2) = x;
+        if (!touch(2)) { return false; }
+        T x = std::move(nth(d - 1));
+        nth(d - 1) = std::move(nth(d - 2));
+        nth(d - 2) = std::move(x);
+        return true;
     }
 
 private:
@@ -411,11 +1967,56 @@ private:
         return *(T*)(stack_ + (n * sizeof(T)));
     }
 
+    // the log and the frames may meet when the buffer is full
+    void relocate(size_t from, size_t to) {
+        if (from == to) { return; }
+        new (&at(to)) T(std::move(at(from)));
+        at(from).~T(); // explicit destructor
+    }
+
+    // the top n frames are to be changed in place; the committed ones
+    // among them are copied to the undo log first, as if popped
+    bool touch(size_t n) {
+        while (top_ - n < gap_) {
+            if (StackSize <= top_ + undo_) { return false; }
+            --gap_;
+            new (&at(StackSize - 1 - undo_++)) T(at(gap_));
+        }
+        return true;
+    }
+
+    // puts back the frames above gap logged in the entries [undo, undo_)
+    void rollback(size_t gap, size_t undo) {
+        while (gap < top_) {
+            at(--top_).~T(); // explicit destructor
+        }
+        while (undo < undo_) {
+            relocate(StackSize - undo_--, top_++);
+        }
+    }
+
+    // hands the log entries [undo, undo_), of the frames lost above gap,
+    // to level_; the ones above level_.gap were not there at its snapshot
+    void merge(size_t gap, size_t undo) {
+        size_t keep = gap < level_.gap ? level_.gap - gap : 0;
+        for (size_t i = undo ; i < undo_ - keep ; i++) {
+            at(StackSize - 1 - i).~T(); // explicit destructor
+        }
+        for (size_t i = 0 ; i < keep ; i++) {
+            relocate(StackSize - 1 - (undo_ - keep + i),
+                     StackSize - 1 - (undo + i));
+        }
+        undo_ = undo + keep;
+        if (gap < level_.gap) { level_.gap = gap; }
+    }
+
 private:
     char stack_[ StackSize * sizeof(T) ];
     size_t top_;
     size_t gap_;
-    size_t tmp_;
+    size_t undo_;
+    size_t base_;
+    level level_;
 
 };
 
@@ -423,20 +2024,26 @@ private:
             );
     }
 
+    if (options.typed_stack) {
+        emit_value_class(os, options, terminal_types, nonterminal_types);
+    }
+
     // parser class header
     stencil(
         os, R"(
-template <${token_parameter}class _Value, class _SemanticAction,
+template <${token_parameter}${value_parameter}class _SemanticAction,
           unsigned int _StackSize = ${default_stack_size}>
 class Parser {
 public:
     typedef ${token_source} token_type;
-    typedef _Value value_type;
+    typedef ${value_source} value_type;
 
     enum Nonterminal {
 )",
         {"token_parameter", options.external_token ? "class _Token, " : ""},
+        {"value_parameter", options.typed_stack ? "" : "class _Value, "},
         {"token_source", options.external_token ? "_Token" : "Token"},
+        {"value_source", options.typed_stack ? "Value" : "_Value"},
         {"default_stack_size", options.dont_use_stl ? "1024" : "0"}
         );
 
@@ -460,6 +2067,7 @@ public:
         error_ = false;
         accepted_ = false;
         clear_stack();
+$${glr_reset}
         rollback_tmp_stack();
         if (push_stack(${first_state}, value_type())) {
             commit_tmp_stack();
@@ -470,18 +2078,73 @@ public:
     }
 
     bool post(token_type token, const value_type& value) {
+        value_type v(value);
+        return post(token, std::move(v));
+    }
+
+    // the reductions token makes are kept even if it turns out to be an
+    // error, and the error is recovered from the stack as they left it,
+    // the same as in post_range and parse
+    bool post(token_type token, value_type&& value) {
         rollback_tmp_stack();
         error_ = false;
-        while ((this->*(stack_top()->entry->state))(token, value))
+        while (${step}(token, value))
             ; // may throw
-        if (!error_) {
-            commit_tmp_stack();
-        } else {
+        commit_tmp_stack();
+        if (error_) {
             recover(token, value);
         }
         return accepted_ || error_;
     }
 
+    // posts [first, last) as a single transaction.  an element is a
+    // (token, value) pair such as std::pair<token_type, value_type>, whose
+    // value is moved from unless the range is const.  returns the token
+    // the parse stopped at (accepted, or an error not recovered from),
+    // or last
+    template <class It>
+    It post_range(It first, It last) {
+        rollback_tmp_stack();
+        error_ = false;
+        for (; first != last; ++first) {
+            value_type v(std::move(first->second));
+            if (post_in_range(first->first, v)) { return first; }
+        }
+        commit_tmp_stack();
+        return last;
+    }
+
+    // same as above, over n tokens and their values; returns the index of
+    // the token the parse stopped at, or n
+    size_t post_range(const token_type* tokens, value_type* values, size_t n) {
+        rollback_tmp_stack();
+        error_ = false;
+        for (size_t i = 0 ; i < n ; i++) {
+            if (post_in_range(tokens[i], values[i])) { return i; }
+        }
+        commit_tmp_stack();
+        return n;
+    }
+
+    // pulls tokens from lexer until the input is accepted or an error is
+    // not recovered from, as a single transaction.  lexer(value) returns
+    // the next token and stores its value in value.  returns true if
+    // accepted.  only the per-call overhead is saved: each token is still
+    // dispatched on stack_top()'s state, reloaded from the stack, so this
+    // runs about as fast as post_range.  the state stays in the program
+    // counter from a shift to the next token only with -goto
+    template <class Lexer>
+    bool parse(Lexer& lexer) {
+        rollback_tmp_stack();
+        error_ = false;
+        value_type value = value_type();
+        for (;;) {
+            token_type token = lexer(value);
+$${parse_token}
+        }
+        return accepted_ && !error_;
+    }
+
     bool accept(value_type& v) {
         assert(accepted_);
         if (error_) { return false; }
@@ -491,27 +2154,116 @@ public:
 
     bool error() { return error_; }
 
+    // a state to come back to for speculative parsing.  taking one costs
+    // O(1), as the frames are shared with the parser until it pops them.
+    // snapshots nest: restore and release apply to the newest one not
+    // released yet, and each one is to be released
+    struct snapshot_type {
+        size_t  gap;
+        size_t  undo;
+        bool    accepted;
+    };
+
+    // the state the next post starts from
+    snapshot_type snapshot() {
+$${glr_snapshot}
+        typename Stack<stack_frame, _StackSize>::level x = stack_.snapshot();
+        snapshot_type s;
+        s.gap = x.gap;
+        s.undo = x.undo;
+        s.accepted = accepted_;
+        return s;
+    }
+
+    // back to the state of s, which stays the newest snapshot
+    void restore(const snapshot_type& s) {
+$${glr_reset}
+        stack_.restore();
+        error_ = false;
+        accepted_ = s.accepted;
+    }
+
+    // forgets s, going on from the current state
+    void release(const snapshot_type& s) {
+        typename Stack<stack_frame, _StackSize>::level x;
+        x.gap = s.gap;
+        x.undo = s.undo;
+        stack_.release(x);
+    }
+
 )",
-        {"first_state", table.first_state()}
+        {"first_state", table.first_state()},
+        {"glr_reset", {
+                // snapshots are out of the branches
+                options.glr ? "        glr_clear();\n" : ""}},
+        {"glr_snapshot",
+            {options.glr ? "        assert(!glr_); // not in the branches\n" : ""}},
+        {"step", step},
+        {"parse_token", [&](std::ostream& os) {
+                if (options.computed_goto) {
+                    // shifts pull the next token inside run
+                    stencil(
+                        os, R"(
+            run(lexer, token, value); // may throw
+            if (settle_in_range(token, value)) { break; }
+)"
+                        );
+                } else {
+                    stencil(
+                        os, R"(
+            if (post_in_range(token, value)) { break; }
+)"
+                        );
+                }
+            }}
         );
 
     // implementation
     stencil(
         os, R"(
 private:
-    typedef Parser<${token_paremter}_Value, _SemanticAction, _StackSize> self_type;
-
-    typedef bool (self_type::*state_type)(token_type, const value_type&);
-    typedef int (self_type::*gotof_type)(Nonterminal);
+    typedef Parser<${token_paremter}${value_argument}_SemanticAction, _StackSize> self_type;
 
+$${table_entry}
     bool            accepted_;
     bool            error_;
     value_type      accepted_value_;
     _SemanticAction& sa_;
 
+$${stack_frame}
+)",
+        {"token_paremter", options.external_token ? "_Token, " : ""},
+        {"value_argument", options.typed_stack ? "" : "_Value, "},
+        {"table_entry", [&](std::ostream& os) {
+                if (state_number) { return; }
+                stencil(
+                    os, R"(
+    typedef bool (self_type::*state_type)(token_type, value_type&);
+
+)"
+                    );
+            }},
+        {"stack_frame", [&](std::ostream& os) {
+                if (state_number) {
+                    stencil(
+                        os, R"(
+    struct stack_frame {
+        int         state;
+        value_type  value;
+        int         sequence_length;
+
+        stack_frame(int s, value_type&& v, int sl)
+            : state(s), value(std::move(v)), sequence_length(sl) {}
+    };
+
+)"
+                        );
+                } else {
+                    stencil(
+                        os, R"(
     struct table_entry {
         state_type  state;
-        gotof_type  gotof;
+        int         state_no;
         bool        handle_error;
     };
 
@@ -520,12 +2272,14 @@ private:
         value_type          value;
         int                 sequence_length;
 
-        stack_frame(const table_entry* e, const value_type& v, int sl)
-            : entry(e), value(v), sequence_length(sl) {}
+        stack_frame(const table_entry* e, value_type&& v, int sl)
+            : entry(e), value(std::move(v)), sequence_length(sl) {}
     };
 
-)",
-        {"token_paremter", options.external_token ? "_Token, " : ""}
+)"
+                        );
+                }
+            }}
         );
 
     // stack operation
@@ -533,8 +2287,8 @@ private:
         os, R"(
     Stack<stack_frame, _StackSize> stack_;
 
-    bool push_stack(int state_index, const value_type& v, int sl = 0) {
-        bool f = stack_.push(stack_frame(entry(state_index), v, sl));
+    bool push_stack(int state_index, value_type&& v, int sl = 0) {
+        bool f = stack_.push(${frame_state}, std::move(v), sl);
         assert(!error_);
         if (!f) { 
             error_ = true;
@@ -555,6 +2309,17 @@ $${pop_stack_implementation}
         return stack_.get_arg(base, index).value;
     }
 
+    // moves the argument out of its frame, unless the frame is committed
+    // and a rollback may need it again
+    template <class T>
+    void downcast_arg(T& x, size_t base, size_t index) {
+        if (stack_frame* f = stack_.uncommitted_arg(base, index)) {
+            ${downcast}(x, std::move(f->value));
+        } else {
+            ${downcast}(x, get_arg(base, index));
+        }
+    }
+
     void clear_stack() {
         stack_.clear();
     }
@@ -568,6 +2333,9 @@ $${pop_stack_implementation}
     }
 
 )",
+        {"frame_state",
+            {state_number ? "state_index" : "entry(state_index)"}},
+        {"downcast", downcast},
         {"pop_stack_implementation", [&](std::ostream& os) {
                 if (options.allow_ebnf) {
                     stencil(
@@ -588,14 +2356,46 @@ $${pop_stack_implementation}
             }}
         );
 
+    // post_range
+    stencil(
+        os, R"(
+    // a token of post_range or parse
+    bool post_in_range(token_type token, value_type& value) {
+        while (${step}(token, value))
+            ; // may throw
+        return settle_in_range(token, value);
+    }
+
+    // after the token stopping the automaton.  the tokens before it stay
+    // in the transaction, and an error is recovered from the stack as the
+    // token left it, reductions included, as in post
+    bool settle_in_range(token_type token, value_type& value) {
+        if (error_) {
+            commit_tmp_stack();
+            recover(token, value);
+            if (!error_) {
+                rollback_tmp_stack();
+            }
+        }
+        if (accepted_) {
+            commit_tmp_stack();
+        }
+        return accepted_ || error_;
+    }
+
+)",
+        {"step", step}
+        );
+
     if (options.recovery) {
         stencil(
             os, R"(
-    void recover(token_type token, const value_type& value) {
+    void recover(token_type token, value_type& value) {
         rollback_tmp_stack();
         error_ = false;
+$${glr_settle}
 $${debmes:start}
-        while(!stack_top()->entry->handle_error) {
+        while(!${top_handles_error}) {
             pop_stack(1);
             if (stack_.empty()) {
 $${debmes:failed}
@@ -606,13 +2406,14 @@ $${debmes:failed}
 $${debmes:done}
         // post error_token;
 $${debmes:post_error_start}
-        while ((this->*(stack_top()->entry->state))(${recovery_token}, value_type()));
+        value_type error_value = value_type();
+        while (${step}(${recovery_token}, error_value));
 $${debmes:post_error_done}
         commit_tmp_stack();
         // repost original token
         // if it still causes error, discard it;
 $${debmes:repost_start}
-        while ((this->*(stack_top()->entry->state))(token, value));
+        while (${step}(token, value));
 $${debmes:repost_done}
         if (!error_) {
             commit_tmp_stack();
@@ -624,6 +2425,16 @@ $${debmes:repost_done}
 
 )",
             {"recovery_token", options.token_prefix + options.recovery_token},
+            {"glr_settle", {
+                    options.glr ?
+                        R"(        if (glr_) {
+            // recovers in the first branch
+            glr_collapse(glr_tops_[0]);
+        }
+)" :
+                        ""}},
+            {"top_handles_error", top_handles_error},
+            {"step", step},
             {"token_eof", options.token_prefix + "eof"},
             {"debmes:start", {
                     options.debug_parser ?
@@ -664,7 +2475,7 @@ $${debmes:repost_done}
     } else {
         stencil(
             os, R"(
-    void recover(token_type, const value_type&) {
+    void recover(token_type, value_type&) {
     }
 
 )"
@@ -699,7 +2510,7 @@ $${debmes:repost_done}
         }
         T operator*() const {
             T v;
-            sa_->downcast(v, s_->nth(p_).value);
+            ${ebnf_downcast}(v, s_->nth(p_).value);
             return v;
         }
 
@@ -710,6 +2521,8 @@ $${debmes:repost_done}
 
     };
 
+    // the elements of a sequence, contiguous frames of the stack, each
+    // converted to T when read
     template <class T>
     class Sequence {
     public:
@@ -717,37 +2530,79 @@ $${debmes:repost_done}
 
         class const_iterator {
         public:
-            typedef T                       value_type;
-            typedef std::input_iterator_tag iterator_category;
-            typedef value_type              reference;
-            typedef value_type*             pointer;
-            typedef size_t                  difference_type;
+            typedef T                               value_type;
+            typedef std::random_access_iterator_tag iterator_category;
+            typedef value_type                      reference;
+            typedef value_type*                     pointer;
+            typedef int                             difference_type;
 
         public:
             const_iterator(_SemanticAction& sa, stack_type& s, int p)
                 : sa_(&sa), s_(&s), p_(p){}
-            const_iterator(const const_iterator& x) : s_(x.s_), p_(x.p_){}
-            const_iterator& operator=(const const_iterator& x) {
-                sa_ = x.sa_;
-                s_ = x.s_;
-                p_ = x.p_;
-                return *this;
-            }
+
             value_type operator*() const {
                 value_type v;
-                sa_->downcast(v, s_->nth(p_).value);
+                ${ebnf_downcast}(v, s_->nth(p_).value);
                 return v;
             }
+            value_type operator[](int n) const {
+                return *(*this + n);
+            }
             const_iterator& operator++() {
                 ++p_;
                 return *this;
             }
+            const_iterator operator++(int) {
+                const_iterator x = *this;
+                ++p_;
+                return x;
+            }
+            const_iterator& operator--() {
+                --p_;
+                return *this;
+            }
+            const_iterator operator--(int) {
+                const_iterator x = *this;
+                --p_;
+                return x;
+            }
+            const_iterator& operator+=(int n) {
+                p_ += n;
+                return *this;
+            }
+            const_iterator& operator-=(int n) {
+                p_ -= n;
+                return *this;
+            }
+            const_iterator operator+(int n) const {
+                const_iterator x = *this;
+                return x += n;
+            }
+            const_iterator operator-(int n) const {
+                const_iterator x = *this;
+                return x -= n;
+            }
+            int operator-(const const_iterator& x) const {
+                return p_ - x.p_;
+            }
             bool operator==(const const_iterator& x) const {
                 return p_ == x.p_;
             }
             bool operator!=(const const_iterator& x) const {
                 return !((*this)==x);
             }
+            bool operator<(const const_iterator& x) const {
+                return p_ < x.p_;
+            }
+            bool operator>(const const_iterator& x) const {
+                return x < *this;
+            }
+            bool operator<=(const const_iterator& x) const {
+                return !(x < *this);
+            }
+            bool operator>=(const const_iterator& x) const {
+                return !(*this < x);
+            }
         private:
             _SemanticAction* sa_;
             stack_type*     s_;
@@ -767,6 +2622,22 @@ $${debmes:repost_done}
             return const_iterator(sa_, stack_, range_.end);
         }
 
+        size_t size() const {
+            return size_t(range_.end - range_.beg);
+        }
+        bool empty() const {
+            return range_.beg == range_.end;
+        }
+        T operator[](size_t n) const {
+            return begin()[int(n)];
+        }
+        T front() const {
+            return *begin();
+        }
+        T back() const {
+            return *(end() - 1);
+        }
+
     private:
         _SemanticAction& sa_;
         stack_type&     stack_;
@@ -775,29 +2646,37 @@ $${debmes:repost_done}
     };
 
     // EBNF support member functions
+    //
+    // a sequence takes a head frame without a value, then a frame per
+    // element.  the top frame of the run has the state of the sequence
+    // and the number of the elements as its sequence_length, so an
+    // element joins it in place, and the run without its top frame is
+    // the sequence as it was before that element
     bool seq_head(Nonterminal nonterminal, int base) {
         // case '*': base == 0
         // case '+': base == 1
-        int dest = (this->*(stack_nth_top(base)->entry->gotof))(nonterminal);
-        return push_stack(dest, value_type(), base);
+        int dest = ${gotof:nth_top};
+        if (!push_stack(dest, value_type())) { return false; }
+        if (base == 0) { return true; }
+
+        // the head goes under the first element
+        return swap_stack_top() && seq_top(dest, 1);
     }
 
     bool seq_trail(Nonterminal, int base) {
         // '*', '+' trailer
         assert(base == 2);
-        stack_.swap_top_and_second();
-        stack_top()->sequence_length++;
-        return true;
+        const stack_frame& s = stack_.nth(stack_.depth() - 2);
+        return seq_top(${state_of:s}, s.sequence_length + 1);
     }
 
     bool seq_trail2(Nonterminal, int base) {
         // '/' trailer
         assert(base == 3);
-        stack_.swap_top_and_second();
+        if (!swap_stack_top()) { return false; }
         pop_stack(1); // erase delimiter
-        stack_.swap_top_and_second();
-        stack_top()->sequence_length++;
-        return true;
+        const stack_frame& s = stack_.nth(stack_.depth() - 2);
+        return seq_top(${state_of:s}, s.sequence_length + 1);
     }
 
     bool opt_nothing(Nonterminal nonterminal, int base) {
@@ -812,20 +2691,46 @@ $${debmes:repost_done}
         return seq_head(nonterminal, base);
     }
 
+    // the frames swapped may have to be kept for a rollback
+    bool swap_stack_top() {
+        bool f = stack_.swap_top_and_second();
+        if (!f) {
+            error_ = true;
+            sa_.stack_overflow();
+        }
+        return f;
+    }
+
+    // makes the top frame the top of a sequence of length elements
+    bool seq_top(int state_index, int length) {
+        stack_frame* f = stack_.touch_top();
+        if (!f) {
+            error_ = true;
+            sa_.stack_overflow();
+            return false;
+        }
+        f->${frame_state_member} = ${frame_state};
+        f->sequence_length = length;
+        return true;
+    }
+
+    // the top frame of the symbol n symbols below the top one
+    int seq_top_frame(int n) {
+        int i = int(stack_.depth()) - 1;
+        while (n--) {
+            i -= 1 + stack_.nth(i).sequence_length;
+        }
+        return i;
+    }
+
     Range seq_get_range(size_t base, size_t index) {
         // returns beg = end if length = 0 (includes scalar value)
         // distinguishing 0-length-vector against scalar value is
         // caller's responsibility
-        int n = int(base - index);
-        assert(0 < n);
-        int prev_actual_index;
-        int actual_index  = stack_.depth();
-        while(n--) {
-            actual_index--;
-            prev_actual_index = actual_index;
-            actual_index -= stack_.nth(actual_index).sequence_length;
-        }
-        return Range(actual_index, prev_actual_index);
+        assert(index < base);
+        int i = seq_top_frame(int(base - index) - 1);
+        int length = stack_.nth(i).sequence_length;
+        return length == 0 ? Range(i, i) : Range(i - length + 1, i + 1);
     }
 
     const value_type& seq_get_arg(size_t base, size_t index) {
@@ -836,12 +2741,16 @@ $${debmes:repost_done}
     }
 
     stack_frame* stack_nth_top(int n) {
-        Range r = seq_get_range(n + 1, 0);
-        // multiple value appearing here is not supported now
-        assert(r.end - r.beg == 0);
-        return &stack_.nth(r.beg);
+        return &stack_.nth(seq_top_frame(n));
     }
-)"
+)",
+            {"gotof:nth_top", gotof("stack_nth_top(base)")},
+            {"ebnf_downcast",
+                options.typed_stack ? "Value::downcast" : "sa_->downcast"},
+            {"state_of:s", state_number ? "s.state" : "s.entry->state_no"},
+            {"frame_state_member", state_number ? "state" : "entry"},
+            {"frame_state",
+                {state_number ? "state_index" : "entry(state_index)"}}
             );
     }
 
@@ -849,13 +2758,34 @@ $${debmes:repost_done}
         os, R"(
     bool call_nothing(Nonterminal nonterminal, int base) {
         pop_stack(base);
-        int dest_index = (this->*(stack_top()->entry->gotof))(nonterminal);
+        int dest_index = ${gotof:top};
         return push_stack(dest_index, value_type());
     }
 
-)"
+)",
+        {"gotof:top", gotof("stack_top()")}
         );
 
+    if (options.bypass_unit_rules) {
+        stencil(
+            os, R"(
+    // a unit rule A : X without an action (--bypass-unit-rules) where its
+    // reduction is not bypassed: the value of X stands for A, as it does
+    // where the reduction is bypassed
+    bool forward_unit(Nonterminal nonterminal, int base) {
+        assert(base == 1);
+        stack_frame* f = stack_.uncommitted_arg(1, 0);
+        value_type v(f ? std::move(f->value) : get_arg(1, 0));
+        pop_stack(base);
+        int dest_index = ${gotof:top};
+        return push_stack(dest_index, std::move(v));
+    }
+
+)",
+            {"gotof:top", gotof("stack_top()")}
+            );
+    }
+
     // member function signature -> index
     std::map<std::vector<std::string>, int> stub_indices;
     {
@@ -911,10 +2841,10 @@ $${debmes:repost_done}
                 );
 
             // check sequence conciousness
-            std::string get_arg = "get_arg";
+            bool sequence = false;
             for (const auto& arg: sa.args) {
                 if (arg.type.extension != Extension::None) {
-                    get_arg = "seq_get_arg";
+                    sequence = true;
                     break;
                 }
             }
@@ -922,13 +2852,22 @@ $${debmes:repost_done}
             // automatic argument conversion
             for (size_t l = 0 ; l < sa.args.size() ; l++) {
                 const auto& arg = sa.args[l];
-                if (arg.type.extension == Extension::None) {
+                if (arg.type.extension == Extension::None && sequence) {
+                    stencil(
+                        os, R"(
+        ${arg_type} arg${index}; ${downcast}(arg${index}, seq_get_arg(base, arg_index${index}));
+)",
+                        {"arg_type", make_type_name(arg.type, options.smart_pointer_tag)},
+                        {"index", l},
+                        {"downcast", downcast}
+                        );
+                } else if (arg.type.extension == Extension::None) {
+                    // scalar arguments are moved out of their frames
                     stencil(
                         os, R"(
-        ${arg_type} arg${index}; sa_.downcast(arg${index}, ${get_arg}(base, arg_index${index}));
+        ${arg_type} arg${index}; downcast_arg(arg${index}, base, arg_index${index});
 )",
                         {"arg_type", make_type_name(arg.type, options.smart_pointer_tag)},
-                        {"get_arg", get_arg},
                         {"index", l}
                         );
                 } else {
@@ -945,13 +2884,17 @@ $${debmes:repost_done}
             stencil(
                 os, R"(
         ${nonterminal_type} r = sa_.${semantic_action_name}(${args});
-        value_type v; sa_.upcast(v, r);
+        ${upcast}
         pop_stack(base);
-        int dest_index = (this->*(stack_top()->entry->gotof))(nonterminal);
-        return push_stack(dest_index, v);
+        int dest_index = ${gotof:top};
+        return push_stack(dest_index, std::move(v));
     }
 
 )",
+                {"gotof:top", gotof("stack_top()")},
+                {"upcast", options.typed_stack ?
+                    "value_type v(std::move(r));" :
+                    "value_type v; sa_.upcast(v, r);"},
                 {"nonterminal_type", make_type_name(rule_type, options.smart_pointer_tag)},
                 {"semantic_action_name", normalize_sa_call(sa.name)},
                 {"args", [&](std::ostream& os) {
@@ -966,281 +2909,41 @@ $${debmes:repost_done}
         }
     }
 
-    // states handler
-    for (const auto& state: table.states()) {
-        // state header
-        stencil(
-            os, R"(
-    bool state_${state_no}(token_type token, const value_type& value) {
-$${debmes:state}
-        switch(token) {
-)",
-            {"state_no", state.no},
-            {"debmes:state", [&](std::ostream& os){
-                    if (options.debug_parser) {
-                        stencil(
-                            os, R"(
-        std::cerr << "state_${state_no} << " << token_label(token) << "\n";
-)",
-                            {"state_no", state.no}
-                            );
-                    }}}
-            );
-
-        // reduce action cache
-        typedef boost::tuple<
-            std::vector<std::string>,
-            std::string,
-            size_t,
-            std::vector<int>>
-            reduce_action_cache_key_type;
-        typedef 
-            std::map<reduce_action_cache_key_type,
-                     std::vector<std::string>>
-            reduce_action_cache_type;
-        reduce_action_cache_type reduce_action_cache;
-
-        // action table
-        for (const auto& pair: state.action_table) {
-            const auto& token = pair.first;
-            const auto& action = pair.second;
-
-            const auto& rule = action.rule;
-
-            // action header 
-            std::string case_tag = options.token_prefix + tokens[token];
-
-            // action
-            switch (action.type) {
-                case zw::gr::action_shift:
-                    stencil(
-                        os, R"(
-        case ${case_tag}:
-            // shift
-            push_stack(/*state*/ ${dest_index}, value);
-            return false;
-)",
-                        {"case_tag", case_tag},
-                        {"dest_index", action.dest_index}
-                        );
-                    break;
-                case zw::gr::action_reduce: {
-                    size_t base = rule.right().size();
-                    const std::string& rule_name = rule.left().name();
-
-                    auto k = finder(actions, rule);
-                    if (k && !(*k).special) {
-                        const auto& sa = *k;
-
-                        std::vector<std::string> signature;
-                        make_signature(
-                            nonterminal_types,
-                            rule,
-                            sa,
-                            signature,
-                            options.smart_pointer_tag);
-
-                        reduce_action_cache_key_type key =
-                            boost::make_tuple(
-                                signature,
-                                rule_name,
-                                base,
-                                sa.source_indices);
-
-                        reduce_action_cache[key].push_back(case_tag);
-                    } else {
-                        stencil(
-                            os, R"(
-        case ${case_tag}:
-)",
-                            {"case_tag", case_tag}
-                            );
-                        std::string funcname = "call_nothing";
-                        if (k) {
-                            const auto& sa = *k;
-                            assert(sa.special);
-                            funcname = sa.name;
-                        }
-                        stencil(
-                            os, R"(
-            // reduce
-            return ${funcname}(Nonterminal_${nonterminal}, /*pop*/ ${base});
-)",
-                            {"funcname", funcname},
-                            {"nonterminal", rule.left().name()},
-                            {"base", base}
-                            );
-                    }
-                }
-                    break;
-                case zw::gr::action_accept:
-                    stencil(
-                        os, R"(
-        case ${case_tag}:
-            // accept
-            accepted_ = true;
-            accepted_value_ = get_arg(1, 0);
-            return false;
-)",
-                        {"case_tag", case_tag}
-                        );
-                    break;
-                case zw::gr::action_error:
-                    stencil(
-                        os, R"(
-        case ${case_tag}:
-            sa_.syntax_error();
-            error_ = true;
-            return false;
-)",
-                        {"case_tag", case_tag}
-                        );
-                    break;
-            }
-
-            // action footer
-        }
-
-        // flush reduce action cache
-        for(const auto& pair: reduce_action_cache) {
-            const reduce_action_cache_key_type& key = pair.first;
-            const std::vector<std::string>& cases = pair.second;
-
-            const std::vector<std::string>& signature = key.get<0>();
-            const std::string& nonterminal_name = key.get<1>();
-            size_t base = key.get<2>();
-            const std::vector<int>& arg_indices = key.get<3>();
-
-            for (size_t j = 0 ; j < cases.size() ; j++){
-                // fall through, be aware when port to other language
-                stencil(
-                    os, R"(
-        case ${case}:
-)",
-                    {"case", cases[j]}
-                    );
-            }
-
-            int index = stub_indices[signature];
-
-            stencil(
-                os, R"(
-            // reduce
-            return call_${index}_${sa_name}(Nonterminal_${nonterminal}, /*pop*/ ${base}${args});
-)",
-                {"index", index},
-                {"sa_name", normalize_internal_sa_name(signature[0])},
-                {"nonterminal", nonterminal_name},
-                {"base", base},
-                {"args", [&](std::ostream& os) {
-                        for(const auto& x: arg_indices) {
-                            os  << ", " << x;
-                        }
-                    }}
-                );
-        }
-
-        // dispatcher footer / state footer
-        stencil(
-            os, R"(
-        default:
-            sa_.syntax_error();
-            error_ = true;
-            return false;
+    if (options.table_driven) {
+        emit_table_driver(
+            os, options, nonterminal_types, tokens, actions, table,
+            stub_indices);
+    } else if (options.computed_goto) {
+        emit_goto_machine(
+            os, options, nonterminal_types, tokens, actions, table,
+            stub_indices);
+    } else {
+        emit_state_functions(
+            os, options, nonterminal_types, tokens, actions, table,
+            stub_indices);
+        if (options.glr) {
+            emit_glr(os, options, nonterminal_types, tokens, actions, table);
         }
     }
 
-)"
-            );
-
-        // gotof header
-        stencil(
-            os, R"(
-    int gotof_${state_no}(Nonterminal nonterminal) {
-)",
-            {"state_no", state.no}
-            );
-            
-        // gotof dispatcher
-        std::stringstream ss;
-        stencil(
-            ss, R"(
-        switch(nonterminal) {
-)"
-            );
-        bool output_switch = false;
-        for (const auto& pair: state.goto_table) {
-            stencil(
-                ss, R"(
-        case Nonterminal_${nonterminal}: return ${state_index};
-)",
-                {"nonterminal", pair.first.name()},
-                {"state_index", pair.second}
-                );
-            output_switch = true;
-        }
-
-        // gotof footer
-        stencil(
-            ss, R"(
-        default: assert(0); return false;
-        }
-)"
-            );
-        if (output_switch) {
-            os << ss.str();
-        } else {
-            stencil(
-                os, R"(
-        assert(0);
-        return true;
-)"
-                );
-        }
-        stencil(os, R"(
-    }
+    // parser class footer
+    stencil(
+        os,
+        R"(
+};
 
 )"
-            );
-
-
-    }
+        );
 
-    // table
-    stencil(
-        os, R"(
-    const table_entry* entry(int n) const {
-        static const table_entry entries[] = {
-$${entries}
-        };
-        return &entries[n];
+    if (!state_number) {
+        emit_state_table(os, options, table);
     }
 
-)",
-        {"entries", [&](std::ostream& os) {
-                int i = 0;
-                for (const auto& state: table.states()) {
-                    stencil(
-                        os, R"(
-            { &Parser::state_${i}, &Parser::gotof_${i}, ${handle_error} },
-)",
-                            
-                        {"i", i},
-                        {"handle_error", state.handle_error}
-                        );
-                    ++i;
-                }                    
-            }}
-        );
-
-    // parser class footer
     // namespace footer
     // once footer
     stencil(
         os,
         R"(
-};
-
 } // namespace ${namespace_name}
 
 #endif // #ifndef ${headername}_
@@ -23,7 +23,7 @@ void generate_csharp(
     const std::map<std::string, Type>&  nonterminal_types,
     const std::vector<std::string>&     tokens,
     const action_map_type&              actions,
-    const tgt::parsing_table&           table) {
+    const tgt::compact_table&           table) {
 
     if (options.allow_ebnf) {
         throw unsupported_feature("C#", "EBNF");
@@ -56,7 +56,7 @@ void generate_csharp(
         for( action_map_type::const_iterator it = actions.begin();
              it != actions.end();
              ++it ) {
-                const tgt::parsing_table::rule_type& rule = it->first;
+                const tgt::compact_table::rule_type& rule = it->first;
                 const SemanticAction& sa = it->second;
                 
                 semantic_action_entry sae;
@@ -327,10 +327,10 @@ void generate_csharp(
                 ;
         
         // states handler
-        for( tgt::parsing_table::states_type::const_iterator i = table.states().begin();
+        for( tgt::compact_table::states_type::const_iterator i = table.states().begin();
              i != table.states().end() ;
              ++i) {
-                const tgt::parsing_table::state& s = *i;
+                const tgt::compact_table::state& s = *i;
 
                 // gotof header
                 os << "		bool gotof_" << s.no << "(int nonterminal_index, object v)\n"
@@ -352,7 +352,7 @@ void generate_csharp(
                                 continue;
                         }
                         
-                        tgt::parsing_table::state::goto_table_type::const_iterator k =
+                        tgt::compact_table::goto_table_type::const_iterator k =
                                 (*i).goto_table.find(rule.left());
                         
                         if( k != (*i).goto_table.end() ) {
@@ -386,7 +386,7 @@ void generate_csharp(
                    << "			{\n";
                 
                 // action table
-                for( tgt::parsing_table::state::action_table_type::const_iterator j = s.action_table.begin();
+                for( tgt::compact_table::action_table_type::const_iterator j = s.action_table.begin();
                      j != s.action_table.end();
                      ++j) {
                         // action header 
@@ -394,7 +394,7 @@ void generate_csharp(
                            << tokens[(*j).first] << ":\n";
                         
                         // action
-                        const tgt::parsing_table::action* a = &(*j).second;
+                        const tgt::compact_table::action* a = &(*j).second;
                         switch( a->type ) {
                         case zw::gr::action_shift:
                                 os << "				// shift\n"
@@ -407,9 +407,9 @@ void generate_csharp(
                         case zw::gr::action_reduce:
                                 os << "				// reduce\n";
                                 {
-                                    size_t base = a->rule.right().size();
+                                    size_t base = table.rule(*a).right().size();
 				        
-                                    const tgt::parsing_table::rule_type& rule = a->rule;
+                                    const tgt::compact_table::rule_type& rule = table.rule(*a);
                                         action_map_type::const_iterator k = actions.find( rule );
                                         
                                         size_t nonterminal_index = std::distance(
@@ -53,7 +53,7 @@ void generate_java(
     const std::map<std::string, Type>&  nonterminal_types,
     const std::vector<std::string>&     tokens,
     const action_map_type&              actions,
-    const tgt::parsing_table&           table) {
+    const tgt::compact_table&           table) {
 
     if (options.allow_ebnf) {
         throw unsupported_feature("Java", "EBNF");
@@ -92,7 +92,7 @@ void generate_java(
 		it != actions.end();
 		++it)
 	{
-		const tgt::parsing_table::rule_type& rule = it->first;
+		const tgt::compact_table::rule_type& rule = it->first;
 		const SemanticAction& sa = it->second;
 
 		semantic_action_entry sae;
@@ -303,12 +303,12 @@ void generate_java(
 	   << "		}\n\n";
 
 	// states handler
-	for(tgt::parsing_table::states_type::const_iterator
+	for(tgt::compact_table::states_type::const_iterator
 		i = table.states().begin();
 		i != table.states().end();
 		++i)
 	{
-		const tgt::parsing_table::state& s = *i;
+		const tgt::compact_table::state& s = *i;
 
 		os << "		private final State state" << s.no << " = new State() {\n";
 
@@ -330,7 +330,7 @@ void generate_java(
 				continue;
 			}
 
-			tgt::parsing_table::state::goto_table_type::const_iterator k =
+			tgt::compact_table::goto_table_type::const_iterator k =
 				(*i).goto_table.find(rule.left());
 
 			if(k != (*i).goto_table.end()) {
@@ -365,7 +365,7 @@ void generate_java(
 		os << "				switch(token) {\n";
 
 		// action table
-		for(tgt::parsing_table::state::action_table_type::const_iterator
+		for(tgt::compact_table::action_table_type::const_iterator
 			j = s.action_table.begin();
 			j != s.action_table.end();
 			++j)
@@ -375,7 +375,7 @@ void generate_java(
 			   << tokens[(*j).first] << ":\n";
 
 			// action
-			const tgt::parsing_table::action* a = &(*j).second;
+			const tgt::compact_table::action* a = &(*j).second;
 			switch(a->type) {
 			case zw::gr::action_shift:
 				os << "					// shift\n"
@@ -386,9 +386,9 @@ void generate_java(
 				break;
 			case zw::gr::action_reduce:
 				{
-                                    size_t base = a->rule.right().size();
+                                    size_t base = table.rule(*a).right().size();
 
-                                    const tgt::parsing_table::rule_type& rule = a->rule;
+                                    const tgt::compact_table::rule_type& rule = table.rule(*a);
 					action_map_type::const_iterator k = actions.find(rule);
 
 					size_t nonterminal_index = std::distance(
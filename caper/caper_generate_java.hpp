@@ -11,6 +11,6 @@ void generate_java(
     const std::map<std::string, Type>&  nonterminal_types,
     const std::vector<std::string>&     tokens,
     const action_map_type&              actions,
-    const tgt::parsing_table&           table);
+    const tgt::compact_table&           table);
 
 #endif  // CAPER_GENERATE_JAVA_HPP
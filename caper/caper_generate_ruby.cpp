@@ -33,7 +33,7 @@ std::string make_type_name(const Type& x) {
         
 void make_signature(
     const std::map<std::string, Type>&      nonterminal_types,
-    const tgt::parsing_table::rule_type&    rule,
+    const tgt::compact_table::rule_type&    rule,
     const SemanticAction&                   sa,
     std::vector<std::string>&               signature) {
     // function name
@@ -59,7 +59,7 @@ void generate_ruby(
     const std::map<std::string, Type>&  nonterminal_types,
     const std::vector<std::string>&     tokens,
     const action_map_type&              actions,
-    const tgt::parsing_table&           table) {
+    const tgt::compact_table&           table) {
 
     if (options.allow_ebnf) {
         throw unsupported_feature("Ruby", "EBNF");
@@ -709,7 +709,7 @@ $${debmes:state}
             const auto& token = pair.first;
             const auto& action = pair.second;
 
-            const auto& rule = action.rule;
+            const auto& rule = table.rule(action);
 
             // action header 
             std::string case_tag =
@@ -25,6 +25,7 @@ public:
         dirdic_["access_modifier"] = token_directive_access_modifier;
         dirdic_["dont_use_stl"] = token_directive_dont_use_stl;
         dirdic_["smart_pointer"] = token_directive_smart_pointer;
+        dirdic_["typed_stack"] = token_directive_typed_stack;
         lines_.push_back(0);
     }
     ~scanner() {}
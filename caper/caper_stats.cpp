@@ -0,0 +1,359 @@
+// Copyright (C) 2006 Naoyuki Hirayama.
+// All Rights Reserved.
+
+#include "caper_stats.hpp"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <set>
+#if defined(__GLIBC__) || defined(_WIN32)
+#include <malloc.h>
+#endif
+
+namespace {
+
+std::atomic<int>    counting(0);
+std::atomic<size_t> allocations(0);
+std::atomic<size_t> allocated_bytes(0);
+
+// bytes held, only where the allocator tells the size of a block
+std::atomic<std::ptrdiff_t> live_bytes(0);
+std::atomic<std::ptrdiff_t> peak_bytes(0);
+
+size_t block_size(void* p) {
+#if defined(__GLIBC__)
+    return malloc_usable_size(p);
+#else
+    (void)p;
+    return 0;
+#endif
+}
+
+std::string format(const char* fmt, double x) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), fmt, x);
+    return buf;
+}
+
+std::string json_string(const std::string& s) {
+    std::string r = "\"";
+    for (char c: s) {
+        switch (c) {
+            case '"':  r += "\\\""; break;
+            case '\\': r += "\\\\"; break;
+            case '\n': r += "\\n"; break;
+            case '\t': r += "\\t"; break;
+            default:
+                if ((unsigned char)c < 0x20) {
+                    char buf[8];
+                    snprintf(buf, sizeof(buf), "\\u%04x", c);
+                    r += buf;
+                } else {
+                    r += c;
+                }
+        }
+    }
+    return r + "\"";
+}
+
+} // namespace
+
+namespace {
+
+void count_new(void* p, size_t n) {
+    if (!counting.load(std::memory_order_relaxed)) { return; }
+
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    allocated_bytes.fetch_add(n, std::memory_order_relaxed);
+
+    std::ptrdiff_t live = live_bytes.fetch_add(
+        block_size(p), std::memory_order_relaxed) + block_size(p);
+    std::ptrdiff_t peak = peak_bytes.load(std::memory_order_relaxed);
+    while (peak < live &&
+           !peak_bytes.compare_exchange_weak(
+               peak, live, std::memory_order_relaxed)) {}
+}
+
+void count_delete(void* p) {
+    if (p && counting.load(std::memory_order_relaxed)) {
+        live_bytes.fetch_sub(block_size(p), std::memory_order_relaxed);
+    }
+}
+
+} // namespace
+
+// every allocation of caper goes through here.  the array forms the
+// library defines call these, so all the replaceable forms are covered
+void* operator new(size_t n) {
+    void* p = std::malloc(n ? n : 1);
+    if (!p) { throw std::bad_alloc(); }
+    count_new(p, n);
+    return p;
+}
+
+void* operator new(size_t n, const std::nothrow_t&) noexcept {
+    void* p = std::malloc(n ? n : 1);
+    if (p) { count_new(p, n); }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    count_delete(p);
+    std::free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+    operator delete(p);
+}
+
+#if defined(__cpp_sized_deallocation)
+void operator delete(void* p, size_t) noexcept {
+    operator delete(p);
+}
+#endif
+
+#if defined(__cpp_aligned_new)
+namespace {
+
+void* aligned_block(size_t n, std::align_val_t a) {
+    size_t alignment = size_t(a);
+#if defined(_WIN32)
+    return _aligned_malloc(n ? n : 1, alignment);
+#else
+    if (alignment < sizeof(void*)) { alignment = sizeof(void*); }
+    void* p = nullptr;
+    return posix_memalign(&p, alignment, n ? n : 1) == 0 ? p : nullptr;
+#endif
+}
+
+void free_aligned_block(void* p) {
+#if defined(_WIN32)
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+
+} // namespace
+
+void* operator new(size_t n, std::align_val_t a) {
+    void* p = aligned_block(n, a);
+    if (!p) { throw std::bad_alloc(); }
+    count_new(p, n);
+    return p;
+}
+
+void* operator new(
+    size_t n, std::align_val_t a, const std::nothrow_t&) noexcept {
+    void* p = aligned_block(n, a);
+    if (p) { count_new(p, n); }
+    return p;
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+    count_delete(p);
+    free_aligned_block(p);
+}
+
+void operator delete(
+    void* p, std::align_val_t a, const std::nothrow_t&) noexcept {
+    operator delete(p, a);
+}
+
+void operator delete(void* p, size_t, std::align_val_t a) noexcept {
+    operator delete(p, a);
+}
+#endif
+
+////////////////////////////////////////////////////////////////
+// heap counters
+heap_counters heap_now() {
+    return heap_counters {
+        allocations.load(), allocated_bytes.load(),
+        live_bytes.load(), peak_bytes.load() };
+}
+
+void reset_heap_peak() {
+    peak_bytes.store(live_bytes.load());
+}
+
+////////////////////////////////////////////////////////////////
+// run_stats
+run_stats::run_stats(bool enabled)
+    : enabled_(enabled), in_table_phase_(false) {
+    if (enabled_) { counting++; }
+}
+
+run_stats::~run_stats() {
+    if (enabled_) { counting--; }
+}
+
+void run_stats::enter(const std::string& name) {
+    if (!enabled_) { return; }
+
+    // allocations and bytes hold the counters until leave
+    open_.push_back(phases_.size());
+    phases_.push_back(
+        phase {
+            name, int(open_.size()) - 1, clock::now(), 0,
+            allocations.load(), allocated_bytes.load() });
+}
+
+void run_stats::leave() {
+    if (!enabled_ || open_.empty()) { return; }
+
+    phase& x = phases_[open_.back()];
+    open_.pop_back();
+    x.ms = std::chrono::duration<double, std::milli>(
+        clock::now() - x.start).count();
+    x.allocations = allocations.load() - x.allocations;
+    x.bytes = allocated_bytes.load() - x.bytes;
+}
+
+void run_stats::attach(zw::gr::lalr_stats& x) {
+    if (!enabled_) { return; }
+
+    x.phase = [this](const char* name) {
+        if (in_table_phase_) { leave(); }
+        in_table_phase_ = name != nullptr;
+        if (name) { enter(name); }
+    };
+}
+
+void run_stats::count(const std::string& name, size_t x) {
+    if (!enabled_) { return; }
+    values_.push_back(value { name, double(x), false });
+}
+
+void run_stats::ratio(const std::string& name, double x) {
+    if (!enabled_) { return; }
+    values_.push_back(value { name, x, true });
+}
+
+void run_stats::write_text(
+    std::ostream& os, const std::string& source) const {
+
+    char buf[256];
+    os << "caper stats: " << source << "\n";
+    snprintf(buf, sizeof(buf), "  %-28s %12s %12s %14s\n",
+             "phase", "ms", "allocs", "bytes");
+    os << buf;
+
+    double total = 0;
+    size_t total_allocations = 0;
+    size_t total_bytes = 0;
+    for (const auto& x: phases_) {
+        std::string name = std::string(x.depth * 2, ' ') + x.name;
+        snprintf(buf, sizeof(buf), "  %-28s %12.2f %12zu %14zu\n",
+                 name.c_str(), x.ms, x.allocations, x.bytes);
+        os << buf;
+        if (x.depth == 0) {
+            total += x.ms;
+            total_allocations += x.allocations;
+            total_bytes += x.bytes;
+        }
+    }
+    snprintf(buf, sizeof(buf), "  %-28s %12.2f %12zu %14zu\n",
+             "total", total, total_allocations, total_bytes);
+    os << buf;
+
+    for (const auto& x: values_) {
+        std::string v = x.ratio ?
+            format("%.2f%%", x.x * 100) : format("%.0f", x.x);
+        snprintf(buf, sizeof(buf), "  %-28s %12s\n",
+                 x.name.c_str(), v.c_str());
+        os << buf;
+    }
+}
+
+void run_stats::write_json(
+    std::ostream& os, const std::string& source) const {
+
+    os << "{\n  \"source\": " << json_string(source) << ",\n";
+
+    // phases nest by depth
+    std::string indent = "  ";  // of the innermost open list
+    int depth = -1;             // of the innermost open phase
+    bool empty = true;          // nothing in the innermost list yet
+    auto close = [&]() {
+        if (!empty) { os << "\n" << indent; }
+        os << "]";
+        indent.resize(indent.size() - 4);
+        os << "\n" << indent << "  }";
+        depth--;
+        empty = false;
+    };
+
+    os << "  \"phases\": [";
+    for (const auto& x: phases_) {
+        while (x.depth <= depth) { close(); }
+        os << (empty ? "\n" : ",\n")
+           << indent << "  {\n"
+           << indent << "    \"name\": " << json_string(x.name) << ",\n"
+           << indent << "    \"ms\": " << format("%.3f", x.ms) << ",\n"
+           << indent << "    \"allocations\": " << x.allocations << ",\n"
+           << indent << "    \"bytes\": " << x.bytes << ",\n"
+           << indent << "    \"phases\": [";
+        indent += "    ";
+        depth = x.depth;
+        empty = true;
+    }
+    while (0 <= depth) { close(); }
+    os << (empty ? "" : "\n  ") << "],\n";
+
+    os << "  \"counts\": {";
+    bool first = true;
+    for (const auto& x: values_) {
+        os << (first ? "\n" : ",\n") << "    " << json_string(x.name) << ": "
+           << (x.ratio ? format("%.6f", x.x) : format("%.0f", x.x));
+        first = false;
+    }
+    os << "\n  }\n}\n";
+}
+
+////////////////////////////////////////////////////////////////
+// count_table
+void count_table(
+    run_stats&                      stats,
+    const tgt::compact_table&       table,
+    const zw::gr::lalr_stats&       table_stats,
+    size_t                          terminal_count) {
+
+    const tgt::grammar& g = table.get_grammar();
+    std::set<const std::string*> nonterminals;
+    for (const auto& rule: g) {
+        nonterminals.insert(rule.left().identity());
+    }
+
+    size_t states = table.states().size();
+    size_t actions = 0;
+    size_t gotos = 0;
+    for (const auto& s: table.states()) {
+        actions += s.action_table.size();
+        gotos += s.goto_table.size();
+    }
+
+    stats.count("terminals", terminal_count);
+    stats.count("nonterminals", nonterminals.size());
+    stats.count("rules", g.size());
+    stats.count("states", states);
+
+    // the automaton is not built when the table comes from the cache
+    if (table_stats.states != 0) {
+        stats.count("kernel_items", table_stats.kernel_items);
+        stats.count("items", table_stats.items);
+        stats.count("transitions", table_stats.transitions);
+    }
+
+    stats.count("actions", actions);
+    stats.count("gotos", gotos);
+    if (states != 0 && terminal_count != 0) {
+        stats.ratio(
+            "action_density", double(actions) / (states * terminal_count));
+    }
+    if (states != 0 && !nonterminals.empty()) {
+        stats.ratio(
+            "goto_density", double(gotos) / (states * nonterminals.size()));
+    }
+}
@@ -0,0 +1,85 @@
+#ifndef CAPER_STATS_HPP
+#define CAPER_STATS_HPP
+
+#include "caper_ast.hpp"
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////
+// run statistics (caper --stats)
+//
+//   wall time and heap allocations of the phases of a run, nested as
+//   they are entered, and counts about the grammar and its table.
+//   Allocations are counted by caper's global operator new, only while
+//   some run_stats is enabled.  A disabled run_stats records nothing.
+
+class run_stats {
+public:
+    explicit run_stats(bool enabled);
+    ~run_stats();
+
+    bool enabled() const { return enabled_; }
+
+    void enter(const std::string& name);
+    void leave();
+
+    // lets the table builder report its phases under the current one
+    void attach(zw::gr::lalr_stats& x);
+
+    void count(const std::string& name, size_t value);
+    void ratio(const std::string& name, double value);
+
+    void write_text(std::ostream& os, const std::string& source) const;
+    void write_json(std::ostream& os, const std::string& source) const;
+
+private:
+    typedef std::chrono::steady_clock clock;
+
+    struct phase {
+        std::string         name;
+        int                 depth;
+        clock::time_point   start;
+        double              ms;
+        size_t              allocations;
+        size_t              bytes;
+    };
+
+    struct value {
+        std::string         name;
+        double              x;
+        bool                ratio;
+    };
+
+    bool                    enabled_;
+    std::vector<phase>      phases_;
+    std::vector<size_t>     open_;
+    bool                    in_table_phase_;
+    std::vector<value>      values_;
+
+};
+
+// the counters of caper's global operator new.  live and peak are
+// relative to when counting began, and stay 0 where the allocator can't
+// tell the size of a block
+struct heap_counters {
+    size_t          allocations;
+    size_t          bytes;
+    std::ptrdiff_t  live;
+    std::ptrdiff_t  peak;       // most live bytes since reset_heap_peak
+};
+
+heap_counters heap_now();
+void reset_heap_peak();
+
+// grammar, automaton and table counts, with the density of the action
+// and goto tables
+void count_table(
+    run_stats&                      stats,
+    const tgt::compact_table&       table,
+    const zw::gr::lalr_stats&       table_stats,
+    size_t                          terminal_count);
+
+#endif // CAPER_STATS_HPP
@@ -265,4 +265,28 @@ void stencil(
     stencil_output(os, t, m);
 }
 
+inline
+void stencil(
+    std::ostream& os, const char* t,
+    const StencilBinding& b0,
+    const StencilBinding& b1,
+    const StencilBinding& b2,
+    const StencilBinding& b3,
+    const StencilBinding& b4,
+    const StencilBinding& b5,
+    const StencilBinding& b6,
+    const StencilBinding& b7,
+    const StencilBinding& b8,
+    const StencilBinding& b9,
+    const StencilBinding& b10,
+    const StencilBinding& b11
+    ) {
+    std::map<std::string, StencilCallback> m;
+    stencil_setup(m, std::cref(b0), std::cref(b1), std::cref(b2),
+                  std::cref(b3), std::cref(b4), std::cref(b5),
+                  std::cref(b6), std::cref(b7), std::cref(b8),
+                  std::cref(b9), std::cref(b10), std::cref(b11));
+    stencil_output(os, t, m);
+}
+
 #endif // CAPER_STENCIL_HPP_
@@ -3,23 +3,36 @@
 
 #include "caper_tgt.hpp"
 #include "caper_error.hpp"
+#include "caper_cache.hpp"
+#include "honalee.hpp"
+#include <sstream>
 
-struct sr_conflict_reporter {
+// messages also go to 'log' if given (for the table cache)
+struct conflict_reporter {
     typedef tgt::rule rule_type;
 
+    conflict_reporter(const char* kind, std::vector<std::string>* log)
+        : kind(kind), log(log) {}
+
     void operator()(const rule_type& x, const rule_type& y) {
-        std::cerr << "shift/reduce conflict: " << x << " vs " << y
-                  << std::endl;
+        std::stringstream ss;
+        ss << kind << " conflict: " << x << " vs " << y;
+        std::cerr << ss.str() << std::endl;
+        if (log) { log->push_back(ss.str()); }
     }
+
+    const char*                 kind;
+    std::vector<std::string>*   log;
 };
 
-struct rr_conflict_reporter {
-    typedef tgt::rule rule_type;
+struct sr_conflict_reporter : public conflict_reporter {
+    sr_conflict_reporter(std::vector<std::string>* log = nullptr)
+        : conflict_reporter("shift/reduce", log) {}
+};
 
-    void operator()(const rule_type& x, const rule_type& y) {
-        std::cerr << "reduce/reduce conflict: " << x << " vs " << y
-                  << std::endl;
-    }
+struct rr_conflict_reporter : public conflict_reporter {
+    rr_conflict_reporter(std::vector<std::string>* log = nullptr)
+        : conflict_reporter("reduce/reduce", log) {}
 };
 
 ////////////////////////////////////////////////////////////////
@@ -87,6 +100,10 @@ void collect_informations(
             // %dont_use_stl錾
             options.dont_use_stl = true;
         }
+        if (auto typedstackdecl = downcast<TypedStackDecl>(x)) {
+            // %typed_stack錾
+            options.typed_stack = true;
+        }
     }
 
     // K
@@ -144,12 +161,14 @@ find_iterator<T, V> finder(const T& c, const V& v) {
 std::string make_extended_name(
     const std::string source_name,
     const std::unordered_map<std::string, tgt::terminal>&     terminals,
-    const std::unordered_map<std::string, tgt::nonterminal>&  nonterminals) {
+    const std::unordered_map<std::string, tgt::nonterminal>&  nonterminals,
+    const std::set<std::string>&                              taken) {
 
     int n = 0;
     while(true) {
         std::string x = source_name + "_seq" + std::to_string(n++);
-        if (terminals.count(x) == 0 && nonterminals.count(x) == 0) {
+        if (terminals.count(x) == 0 && nonterminals.count(x) == 0 &&
+            taken.count(x) == 0) {
             return x;
         }            
     }
@@ -236,14 +255,23 @@ void make_target_rule(
         }
 
         if (item->extension != Extension::None) {
-            std::string extended_name =
-                make_extended_name(item->name, terminals, nonterminals);
-
+            // the same extension shares one nonterminal; X* and X+ are
+            // not registered until all rules are read, so they are kept
+            // apart by the names already pending
             PendingKey k { item->name, item->extension, item->skip };
-            PendingValue v { extended_name };
+            auto i = pendings.find(k);
+            if (i == pendings.end()) {
+                std::set<std::string> taken;
+                for (const auto& p: pendings) {
+                    taken.insert(p.second.extended_name);
+                }
+                PendingValue v {
+                    make_extended_name(
+                        item->name, terminals, nonterminals, taken) };
+                i = pendings.insert(std::make_pair(k, v)).first;
+            }
             
-            r << tgt::nonterminal(extended_name);
-            pendings[k] = v;
+            r << tgt::nonterminal((*i).second.extended_name);
         } else {
             r << find_symbol(item->name, terminals, nonterminals);
         }
@@ -274,8 +302,9 @@ void make_target_rule(
     g << r;
 }
 
-void make_target_parser(
-    tgt::parsing_table&             table,
+void make_target_grammar(
+    tgt::grammar&                   g,
+    int&                            error_token,
     std::map<std::string, size_t>&  token_id_map,
     action_map_type&                actions,
     const value_type&               ast,
@@ -290,7 +319,7 @@ void make_target_parser(
     // ...I[L\(Ononterminal)
     std::unordered_map<std::string, tgt::nonterminal>   nonterminals;
 
-    int error_token = -1;
+    error_token = -1;
 
     // terminals̍쐬
     token_id_map["eof"] = 0;
@@ -315,7 +344,6 @@ void make_target_parser(
     std::map<PendingKey, PendingValue> pending;
 
     // K
-    tgt::grammar g;
     for (const auto& rule: doc->rules->rules) {
         const tgt::nonterminal& rule_left = nonterminals[rule->name];
         if (g.size() == 0) {
@@ -373,11 +401,67 @@ void make_target_parser(
             actions[list1] = SemanticAction { "seq_trail", true };
         }
     }
+}
 
-    zw::gr::make_lalr_table(
-        table,
+void make_target_parser(
+    tgt::compact_table&             table,
+    std::map<std::string, size_t>&  token_id_map,
+    action_map_type&                actions,
+    const value_type&               ast,
+    std::map<std::string, Type>&    terminal_types,
+    std::map<std::string, Type>&    nonterminal_types,
+    const zw::gr::lalr_options&     lalr_options,
+    const std::string&              cache_dir) {
+
+    tgt::grammar g;
+    int error_token;
+    make_target_grammar(
         g,
         error_token,
-        sr_conflict_reporter(),
-        rr_conflict_reporter());
+        token_id_map,
+        actions,
+        ast,
+        terminal_types,
+        nonterminal_types);
+
+    // \e[ũLbV
+    std::string digest;
+    std::vector<std::string> messages;
+    if (!cache_dir.empty()) {
+        digest = table_digest(g, error_token, lalr_options);
+        if (load_cached_table(table, messages, cache_dir, digest, g)) {
+            for (const auto& x: messages) {
+                std::cerr << x << std::endl;
+            }
+            return;
+        }
+    }
+    std::vector<std::string>* log = cache_dir.empty() ? nullptr : &messages;
+
+    tgt::parsing_table built;
+
+    if (lalr_options.algorithm == zw::gr::table_minimal_lr1) {
+        // minimal LR(1)
+        zw::gr::make_lr1_table(
+            built,
+            g,
+            error_token,
+            sr_conflict_reporter(log),
+            rr_conflict_reporter(log),
+            lalr_options);
+    } else {
+        zw::gr::make_lalr_table(
+            built,
+            g,
+            error_token,
+            sr_conflict_reporter(log),
+            rr_conflict_reporter(log),
+            lalr_options);
+    }
+
+    table = tgt::compact_table(std::move(built));
+
+    if (!cache_dir.empty()) {
+        save_cached_table(cache_dir, digest, table, messages);
+    }
 }
@@ -11,14 +11,28 @@ void collect_informations(
     std::map<std::string, Type>&    nonterminal_types,
     const value_type&               ast);
 
+////////////////////////////////////////////////////////////////
+// make_target_grammar
+//   the target grammar with its EBNF expanded, before any table is made
+void make_target_grammar(
+    tgt::grammar&                   g,
+    int&                            error_token,
+    std::map<std::string, size_t>&  token_id_map,
+    action_map_type&                actions,
+    const value_type&               ast,
+    std::map<std::string, Type>&    terminal_types,
+    std::map<std::string, Type>&    nonterminal_types);
+
 ////////////////////////////////////////////////////////////////
 // make_target_parser
 void make_target_parser(
-    tgt::parsing_table&             table,
+    tgt::compact_table&             table,
     std::map<std::string, size_t>&  token_id_map,
     action_map_type&                actions,
     const value_type&               ast,
     std::map<std::string, Type>&    terminal_types,
-    std::map<std::string, Type>&    nonterminal_types);
+    std::map<std::string, Type>&    nonterminal_types,
+    const zw::gr::lalr_options&     lalr_options,
+    const std::string&              cache_dir);
 
 #endif // CAPER_TGT_HPP
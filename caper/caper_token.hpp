@@ -33,6 +33,7 @@ enum Token {
     token_directive_access_modifier,
     token_directive_dont_use_stl,
     token_directive_smart_pointer,
+    token_directive_typed_stack,
     token_eof,
 };
 
@@ -70,6 +71,7 @@ const char* token_labels(Token op) {
         "%access_modifier",
         "%dont_use_stl",
         "%smart_pointer",
+        "%typed_stack",
         "$"
     };
 
@@ -0,0 +1,686 @@
+// Copyright (C) 2006 Naoyuki Hirayama.
+// All Rights Reserved.
+
+// $Id$
+
+#if !defined(ZW_DENSE_HPP)
+#define ZW_DENSE_HPP
+
+// module: dense
+//   integer encoding of a grammar for table construction
+
+#include <cstdint>
+#include <cassert>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <algorithm>
+#include <boost/dynamic_bitset.hpp>
+#include "grammar.hpp"
+#include "digraph.hpp"
+
+namespace zw {
+
+namespace gr {
+
+/*============================================================================
+ *
+ * dense_core
+ *
+ * LR(0) item packed as (rule id << 32 | cursor).  The natural order of
+ * the packed words is the order of core<Token, Traits>, so sorted
+ * vectors of them compare like core_set.
+ *
+ *==========================================================================*/
+
+typedef std::uint64_t           dense_core;
+typedef std::vector<dense_core> dense_core_set;     // sorted, unique
+typedef boost::dynamic_bitset<> lookahead_set;      // indexed by terminal id
+
+inline dense_core make_dense_core(int rule, int cursor) {
+    return (dense_core(rule) << 32) | dense_core(unsigned(cursor));
+}
+
+inline int dense_rule(dense_core x)     { return int(x >> 32); }
+inline int dense_cursor(dense_core x)   { return int(x & 0xffffffffu); }
+
+/*============================================================================
+ *
+ * class dense_grammar
+ *
+ * symbols are numbered terminals first ([0, terminal_count()), sorted by
+ * token), then nonterminals in order of appearance; rules by their
+ * position in the grammar (0 = root).  Right sides are
+ * stored back to back in one array, each followed by -1, so a core maps
+ * to a position of that array and its next symbol is a single load.
+ *
+ *==========================================================================*/
+
+template <class Token, class Traits>
+class dense_grammar {
+public:
+    typedef zw::gr::terminal<Token, Traits>     terminal_type;
+    typedef zw::gr::nonterminal<Token, Traits>  nonterminal_type;
+    typedef zw::gr::symbol<Token, Traits>       symbol_type;
+    typedef zw::gr::rule<Token, Traits>         rule_type;
+    typedef zw::gr::grammar<Token, Traits>      grammar_type;
+
+public:
+    dense_grammar(
+        const grammar_type&                 g,
+        const std::vector<terminal_type>&   extra_terminals)
+        : source_(g) {
+
+        // terminals
+        std::map<Token, terminal_type> terminals;
+        for (const auto& x: extra_terminals) {
+            terminals.insert(std::make_pair(x.token(), x));
+        }
+        for (const auto& rule: g) {
+            for (const auto& x: rule.right()) {
+                if (x.is_terminal()) {
+                    terminals.insert(
+                        std::make_pair(x.token(), x.as_terminal()));
+                }
+            }
+        }
+        for (const auto& x: terminals) {
+            terminal_ids_[x.first] = int(symbols_.size());
+            symbols_.push_back(symbol_type(x.second));
+        }
+        terminal_count_ = int(symbols_.size());
+
+        // nonterminals
+        for (const auto& rule: g) {
+            add_nonterminal(rule.left());
+            for (const auto& x: rule.right()) {
+                if (x.is_nonterminal()) {
+                    add_nonterminal(x.as_nonterminal());
+                }
+            }
+        }
+        rules_of_.resize(symbols_.size() - terminal_count_);
+
+        // rules
+        for (const auto& rule: g) {
+            int left = symbol_id(symbol_type(rule.left()));
+            left_.push_back(left);
+            offset_.push_back(int(right_.size()));
+            for (const auto& x: rule.right()) {
+                assert(!x.is_epsilon());
+                right_.push_back(symbol_id(x));
+            }
+            right_.push_back(-1);
+            rules_of_[left - terminal_count_].push_back(int(left_.size()) - 1);
+        }
+        offset_.push_back(int(right_.size()));
+    }
+
+    int terminal_count() const      { return terminal_count_; }
+    int nonterminal_count() const   { return symbol_count() - terminal_count_; }
+    int symbol_count() const        { return int(symbols_.size()); }
+    bool is_terminal(int x) const   { return x < terminal_count_; }
+
+    int symbol_id(const symbol_type& x) const {
+        if (x.is_terminal()) {
+            return terminal_id(x.token());
+        } else {
+            return (*nonterminal_ids_.find(x.identity())).second;
+        }
+    }
+    int terminal_id(Token t) const {
+        return (*terminal_ids_.find(t)).second;
+    }
+    const symbol_type& symbol(int x) const { return symbols_[x]; }
+
+    int rule_count() const          { return int(left_.size()); }
+    int left(int r) const           { return left_[r]; }
+    int length(int r) const         { return offset_[r+1] - offset_[r] - 1; }
+    const rule_type& rule(int r) const { return source_.at(r); }
+    const std::vector<int>& rules_of(int x) const {
+        return rules_of_[x - terminal_count_];
+    }
+
+    // position of a core in the right side array
+    int position(dense_core x) const {
+        return offset_[dense_rule(x)] + dense_cursor(x);
+    }
+    int position_count() const      { return int(right_.size()); }
+    int at(int position) const      { return right_[position]; }
+
+    // next symbol, -1 if the cursor is at the end
+    int next(dense_core x) const    { return right_[position(x)]; }
+
+    const grammar_type& source() const { return source_; }
+
+private:
+    void add_nonterminal(const nonterminal_type& x) {
+        if (nonterminal_ids_.count(x.identity())) { return; }
+        nonterminal_ids_[x.identity()] = int(symbols_.size());
+        symbols_.push_back(symbol_type(x));
+    }
+
+private:
+    const grammar_type&                             source_;
+    std::vector<symbol_type>                        symbols_;
+    int                                             terminal_count_;
+    std::map<Token, int>                            terminal_ids_;
+    std::unordered_map<const std::string*, int>     nonterminal_ids_;
+    std::vector<int>                                left_;
+    std::vector<int>                                offset_;
+    std::vector<int>                                right_;
+    std::vector<std::vector<int>>                   rules_of_;
+
+};
+
+/*============================================================================
+ *
+ * struct dense_first
+ *
+ * nullable / FIRST per symbol, and per right side position the same for
+ * the suffix starting there
+ *
+ *==========================================================================*/
+
+struct dense_first {
+    std::vector<char>           nullable;
+    std::vector<lookahead_set>  first;
+    std::vector<char>           tail_nullable;
+    std::vector<lookahead_set>  tail_first;
+};
+
+template <class Token, class Traits>
+void make_dense_tails(
+    dense_first&                            df,
+    const dense_grammar<Token, Traits>&     g) {
+
+    int n = g.position_count();
+    df.tail_nullable.assign(n, 1);
+    df.tail_first.assign(n, lookahead_set(g.terminal_count()));
+    for (int p = n - 1 ; 0 <= p ; p--) {
+        int x = g.at(p);
+        if (x < 0) { continue; }
+        df.tail_first[p] = df.first[x];
+        if (df.nullable[x]) {
+            df.tail_first[p] |= df.tail_first[p+1];
+            df.tail_nullable[p] = df.tail_nullable[p+1];
+        } else {
+            df.tail_nullable[p] = 0;
+        }
+    }
+}
+
+/*============================================================================
+ *
+ * make_dense_first
+ *
+ * nullable by counting the not-yet-nullable symbols of each right side,
+ * then FIRST as the least solution of
+ *
+ *   FIRST(A) = { t | A -> a t b, a nullable }
+ *            U { FIRST(B) | A -> a B b, a nullable }
+ *
+ * by digraph, which visits the dependency graph once in SCC order.
+ *
+ *==========================================================================*/
+
+template <class Token, class Traits>
+void make_dense_first(
+    dense_first&                            df,
+    const dense_grammar<Token, Traits>&     g) {
+
+    int symbol_count = g.symbol_count();
+    int rule_count = g.rule_count();
+
+    // nullable
+    df.nullable.assign(symbol_count, 0);
+
+    std::vector<int> count(rule_count, 0);
+    std::vector<std::vector<int>> occurrences(symbol_count);
+    std::vector<int> queue;
+    for (int r = 0 ; r < rule_count ; r++) {
+        int n = g.length(r);
+        int p = g.position(make_dense_core(r, 0));
+        for (int i = 0 ; i < n ; i++) {
+            int x = g.at(p + i);
+            if (g.is_terminal(x)) {
+                count[r] = -1;
+                break;
+            }
+            count[r]++;
+        }
+        if (count[r] < 0) { continue; }
+        for (int i = 0 ; i < n ; i++) {
+            occurrences[g.at(p + i)].push_back(r);
+        }
+        if (count[r] == 0) { queue.push_back(r); }
+    }
+    while (!queue.empty()) {
+        int r = queue.back();
+        queue.pop_back();
+
+        int x = g.left(r);
+        if (df.nullable[x]) { continue; }
+        df.nullable[x] = 1;
+
+        for (int r2: occurrences[x]) {
+            if (--count[r2] == 0) { queue.push_back(r2); }
+        }
+    }
+
+    // FIRST
+    df.first.assign(symbol_count, lookahead_set(g.terminal_count()));
+
+    std::vector<std::vector<int>> R(symbol_count);
+    for (int x = 0 ; x < g.terminal_count() ; x++) {
+        df.first[x].set(x);
+    }
+    for (int r = 0 ; r < rule_count ; r++) {
+        int A = g.left(r);
+        for (int p = g.position(make_dense_core(r, 0)) ; 0 <= g.at(p) ; p++) {
+            int x = g.at(p);
+            if (g.is_terminal(x)) {
+                df.first[A].set(x);
+                break;
+            }
+            R[A].push_back(x);
+            if (!df.nullable[x]) { break; }
+        }
+    }
+    digraph(df.first, R);
+
+    make_dense_tails(df, g);
+}
+
+/*============================================================================
+ *
+ * make_dense_follow
+ *
+ *   FOLLOW(S) contains eof
+ *   FOLLOW(X) = U { FIRST(b) | A -> a X b }
+ *             U { FOLLOW(A) | A -> a X b, b nullable }
+ *
+ * by digraph as FIRST.  follow is indexed by symbol.
+ *
+ *==========================================================================*/
+
+template <class Token, class Traits>
+void make_dense_follow(
+    std::vector<lookahead_set>&             follow,
+    const dense_grammar<Token, Traits>&     g,
+    const dense_first&                      df,
+    int                                     eof) {
+
+    int symbol_count = g.symbol_count();
+    follow.assign(symbol_count, lookahead_set(g.terminal_count()));
+    follow[g.left(0)].set(eof);
+
+    std::vector<std::vector<int>> R(symbol_count);
+    for (int r = 0 ; r < g.rule_count() ; r++) {
+        int A = g.left(r);
+        for (int p = g.position(make_dense_core(r, 0)) ; 0 <= g.at(p) ; p++) {
+            int x = g.at(p);
+            follow[x] |= df.tail_first[p + 1];
+            if (df.tail_nullable[p + 1] && x != A) {
+                R[x].push_back(A);
+            }
+        }
+    }
+    digraph(follow, R);
+}
+
+/*============================================================================
+ *
+ * make_dense_lr0_closure / make_dense_lr0_goto
+ *
+ *==========================================================================*/
+
+template <class Token, class Traits>
+void make_dense_lr0_closure(
+    dense_core_set&                         J,
+    const dense_grammar<Token, Traits>&     g) {
+
+    std::vector<char> added(g.nonterminal_count(), 0);
+
+    for (size_t i = 0 ; i < J.size() ; i++) {
+        int x = g.next(J[i]);
+        if (x < 0 || g.is_terminal(x)) { continue; }
+
+        char& a = added[x - g.terminal_count()];
+        if (a) { continue; }
+        a = 1;
+
+        for (int r: g.rules_of(x)) {
+            J.push_back(make_dense_core(r, 0));
+        }
+    }
+
+    std::sort(J.begin(), J.end());
+    J.erase(std::unique(J.begin(), J.end()), J.end());
+}
+
+template <class Token, class Traits>
+void make_dense_lr0_goto(
+    dense_core_set&                         J,
+    const dense_core_set&                   I,
+    int                                     X,
+    const dense_grammar<Token, Traits>&     g) {
+
+    for (dense_core x: I) {
+        if (g.next(x) == X) {
+            J.push_back(x + 1);
+        }
+    }
+
+    make_dense_lr0_closure(J, g);
+}
+
+/*============================================================================
+ *
+ * class dense_lr1_closure
+ *
+ * LR(1) closure of a kernel whose items carry lookahead sets.  All
+ * nonkernel items of one left side share their lookaheads, so they are
+ * kept per nonterminal.  Scratch storage is reused between calls.
+ *
+ *==========================================================================*/
+
+template <class Token, class Traits>
+class dense_lr1_closure {
+public:
+    typedef dense_grammar<Token, Traits> dense_grammar_type;
+
+public:
+    dense_lr1_closure(const dense_grammar_type& g, const dense_first& first)
+        : g_(g), first_(first),
+          la_(g.nonterminal_count(), lookahead_set(g.terminal_count())),
+          reached_mark_(g.nonterminal_count(), 0),
+          queued_mark_(g.nonterminal_count(), 0) {}
+
+    void operator()(
+        const dense_core_set&               kernel,
+        const std::vector<lookahead_set>&   kernel_la) {
+
+        for (int x: reached_) {
+            la_[x - g_.terminal_count()].reset();
+            reached_mark_[x - g_.terminal_count()] = 0;
+        }
+        reached_.clear();
+
+        for (size_t i = 0 ; i < kernel.size() ; i++) {
+            contribute(g_.position(kernel[i]), kernel_la[i]);
+        }
+
+        while (!queue_.empty()) {
+            int x = queue_.back();
+            queue_.pop_back();
+            queued_mark_[x - g_.terminal_count()] = 0;
+
+            const lookahead_set& la = la_[x - g_.terminal_count()];
+            for (int r: g_.rules_of(x)) {
+                contribute(g_.position(make_dense_core(r, 0)), la);
+            }
+        }
+    }
+
+    // nonterminals whose rules are in the closure
+    const std::vector<int>& reached() const { return reached_; }
+
+    bool reached(int x) const {
+        return reached_mark_[x - g_.terminal_count()] != 0;
+    }
+
+    // lookaheads of the nonkernel items [x -> .w]
+    const lookahead_set& lookahead(int x) const {
+        return la_[x - g_.terminal_count()];
+    }
+
+    // every item of the closure, sorted by core
+    void items(
+        std::vector<std::pair<dense_core, lookahead_set>>&  out,
+        const dense_core_set&                               kernel,
+        const std::vector<lookahead_set>&                   kernel_la) const {
+
+        out.clear();
+        for (size_t i = 0 ; i < kernel.size() ; i++) {
+            out.push_back(std::make_pair(kernel[i], kernel_la[i]));
+        }
+        for (int x: reached_) {
+            for (int r: g_.rules_of(x)) {
+                out.push_back(
+                    std::make_pair(make_dense_core(r, 0), lookahead(x)));
+            }
+        }
+        std::sort(
+            out.begin(), out.end(),
+            [](const std::pair<dense_core, lookahead_set>& a,
+               const std::pair<dense_core, lookahead_set>& b) {
+                return a.first < b.first;
+            });
+
+        // a root item may be kernel and nonkernel at once
+        size_t n = 0;
+        for (size_t i = 0 ; i < out.size() ; i++) {
+            if (0 < n && out[n-1].first == out[i].first) {
+                out[n-1].second |= out[i].second;
+            } else {
+                if (n != i) { out[n] = out[i]; }
+                n++;
+            }
+        }
+        out.resize(n);
+    }
+
+private:
+    // [A -> a.Bb, L] adds FIRST(bL) to the lookaheads of B
+    void contribute(int position, const lookahead_set& L) {
+        int x = g_.at(position);
+        if (x < 0 || g_.is_terminal(x)) { return; }
+
+        int n = x - g_.terminal_count();
+        lookahead_set& la = la_[n];
+
+        bool changed = false;
+        const lookahead_set& f = first_.tail_first[position + 1];
+        if (!f.is_subset_of(la)) {
+            la |= f;
+            changed = true;
+        }
+        if (first_.tail_nullable[position + 1] && !L.is_subset_of(la)) {
+            la |= L;
+            changed = true;
+        }
+
+        if (!reached_mark_[n]) {
+            reached_mark_[n] = 1;
+            reached_.push_back(x);
+            changed = true;
+        }
+        if (changed && !queued_mark_[n]) {
+            queued_mark_[n] = 1;
+            queue_.push_back(x);
+        }
+    }
+
+private:
+    const dense_grammar_type&   g_;
+    const dense_first&          first_;
+    std::vector<lookahead_set>  la_;
+    std::vector<char>           reached_mark_;
+    std::vector<char>           queued_mark_;
+    std::vector<int>            reached_;
+    std::vector<int>            queue_;
+
+};
+
+/*============================================================================
+ *
+ * struct dense_automaton
+ *
+ * LR(0) automaton over dense cores
+ *
+ *==========================================================================*/
+
+struct dense_state {
+    dense_core_set                      kernel;
+    dense_core_set                      cores;          // closure
+    std::vector<std::pair<int, int>>    transitions;    // (symbol, state)
+
+    // destination of the transition on x, -1 if none
+    int go(int x) const {
+        auto i = std::lower_bound(
+            transitions.begin(), transitions.end(),
+            std::make_pair(x, -1));
+        if (i == transitions.end() || (*i).first != x) { return -1; }
+        return (*i).second;
+    }
+
+    // index of a kernel item, -1 if none
+    int kernel_index(dense_core x) const {
+        auto i = std::lower_bound(kernel.begin(), kernel.end(), x);
+        if (i == kernel.end() || *i != x) { return -1; }
+        return int(i - kernel.begin());
+    }
+};
+
+struct dense_automaton {
+    std::vector<dense_state> states;
+};
+
+/*============================================================================
+ *
+ * make_dense_lr0_automaton
+ *
+ * canonical LR(0) collection by a worklist.  Each state is closed once;
+ * the kernels of all its successors come out of one pass over its items
+ * bucketed by next symbol, and are interned in a hash table.  States are
+ * finally renumbered in the order of their closures, as lr0_collection
+ * orders them.
+ *
+ * expand(kernel, cores, successors) is asked first for each state, with
+ * the kernel it was reached by.  It may give the closure and the
+ * (symbol, kernel) of every successor, sorted by symbol, of a state it
+ * already knows and return true; otherwise the state is closed here.
+ *
+ *==========================================================================*/
+
+struct dense_core_set_hash {
+    size_t operator()(const dense_core_set& x) const {
+        std::uint64_t h = 14695981039346656037ULL;
+        for (dense_core c: x) {
+            h ^= c;
+            h *= 1099511628211ULL;
+        }
+        return size_t(h ^ (h >> 32));
+    }
+};
+
+template <class Token, class Traits, class Expand>
+void make_dense_lr0_automaton(
+    dense_automaton&                        a,
+    const dense_grammar<Token, Traits>&     g,
+    Expand                                  expand) {
+
+    std::vector<dense_state> states;
+    std::unordered_map<dense_core_set, int, dense_core_set_hash> kernels;
+
+    auto intern = [&](dense_core_set& K) {
+        auto i = kernels.find(K);
+        if (i != kernels.end()) { return (*i).second; }
+
+        int n = int(states.size());
+        kernels[K] = n;
+        states.push_back(dense_state());
+        states.back().kernel = std::move(K);
+        return n;
+    };
+
+    dense_core_set start { make_dense_core(0, 0) };
+    intern(start);
+
+    std::vector<dense_core_set> buckets(g.symbol_count());
+    std::vector<int> symbols;
+    std::vector<std::pair<int, dense_core_set>> successors;
+
+    for (size_t i = 0 ; i < states.size() ; i++) {
+        dense_core_set cores;
+        std::vector<std::pair<int, int>> transitions;
+
+        successors.clear();
+        if (expand(states[i].kernel, cores, successors)) {
+            for (auto& x: successors) {
+                transitions.push_back(
+                    std::make_pair(x.first, intern(x.second)));
+            }
+        } else {
+            // closure
+            cores = states[i].kernel;
+            make_dense_lr0_closure(cores, g);
+
+            // successor kernels; cores are sorted, and so is each bucket
+            symbols.clear();
+            for (dense_core x: cores) {
+                int X = g.next(x);
+                if (X < 0) { continue; }
+                if (buckets[X].empty()) { symbols.push_back(X); }
+                buckets[X].push_back(x + 1);
+            }
+            std::sort(symbols.begin(), symbols.end());
+
+            for (int X: symbols) {
+                transitions.push_back(std::make_pair(X, intern(buckets[X])));
+                buckets[X].clear();
+            }
+        }
+
+        // the kernel keeps root items the closure brings in
+        dense_core_set kernel;
+        for (dense_core x: cores) {
+            if (dense_rule(x) == 0 || 0 < dense_cursor(x)) {
+                kernel.push_back(x);
+            }
+        }
+
+        dense_state& s = states[i];
+        s.kernel = std::move(kernel);
+        s.cores = std::move(cores);
+        s.transitions = std::move(transitions);
+    }
+
+    // renumbering
+    std::vector<int> order(states.size());
+    for (size_t i = 0 ; i < order.size() ; i++) { order[i] = int(i); }
+    std::sort(
+        order.begin(), order.end(),
+        [&](int x, int y) { return states[x].cores < states[y].cores; });
+
+    std::vector<int> renumber(states.size());
+    for (size_t i = 0 ; i < order.size() ; i++) {
+        renumber[order[i]] = int(i);
+    }
+
+    a.states.clear();
+    a.states.reserve(states.size());
+    for (int x: order) {
+        dense_state& s = states[x];
+        for (auto& t: s.transitions) { t.second = renumber[t.second]; }
+        a.states.push_back(std::move(s));
+    }
+}
+
+template <class Token, class Traits>
+void make_dense_lr0_automaton(
+    dense_automaton&                        a,
+    const dense_grammar<Token, Traits>&     g) {
+    make_dense_lr0_automaton(
+        a, g,
+        [](const dense_core_set&,
+           dense_core_set&,
+           std::vector<std::pair<int, dense_core_set>>&) { return false; });
+}
+
+} // namespace gr
+
+} // namespace zw
+
+#endif // ZW_DENSE_HPP
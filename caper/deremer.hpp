@@ -0,0 +1,162 @@
+// Copyright (C) 2006 Naoyuki Hirayama.
+// All Rights Reserved.
+
+// $Id$
+
+#if !defined(ZW_DEREMER_HPP)
+#define ZW_DEREMER_HPP
+
+// module: deremer
+//   LALR(1) lookaheads by DeRemer & Pennello's relations
+//   (Efficient Computation of LALR(1) Look-Ahead Sets, TOPLAS 1982)
+
+#include <vector>
+#include <functional>
+#include <cassert>
+#include "dense.hpp"
+#include "digraph.hpp"
+
+namespace zw {
+
+namespace gr {
+
+/*============================================================================
+ *
+ * make_deremer_lookaheads
+ *
+ * computes the LALR(1) lookaheads of every kernel item of the LR(0)
+ * automaton.  la holds per state and kernel item the lookaheads given
+ * in advance (eof for the root item) and receives the result.
+ *
+ *   DR(p,A)    = { t | goto(goto(p,A), t) exists }
+ *   (p,A) reads (r,C)      iff r = goto(p,A), C nullable
+ *   (p,A) includes (p',B)  iff B -> bAc, c nullable, p' --b--> p
+ *   Read   = digraph(DR, reads)
+ *   Follow = digraph(Read, includes)
+ *   LA(q, [A -> a.b]) = U { Follow(p,A) | p --a--> q }
+ *
+ * The last line is the lookback relation, extended from completed items
+ * to every kernel item so that the closure step downstream is shared
+ * with the propagation algorithm and yields the very same table.
+ *
+ *==========================================================================*/
+
+template <class Token, class Traits>
+void make_deremer_lookaheads(
+    std::vector<std::vector<lookahead_set>>&    la,
+    const dense_automaton&                      a,
+    const dense_grammar<Token, Traits>&         g,
+    const dense_first&                          first) {
+
+    const auto& states = a.states;
+    int terminal_count = g.terminal_count();
+
+    // nonterminal transitions (p,A), numbered in the order of the
+    // transitions of each state; the extra ones at the end stand for the
+    // root rule and carry the given lookaheads of the root item
+    struct transition {
+        int from;
+        int label;
+    };
+    std::vector<transition> transitions;
+    std::vector<std::vector<int>> transition_index(states.size());
+    for (int p = 0 ; p < int(states.size()) ; p++) {
+        for (const auto& x: states[p].transitions) {
+            if (g.is_terminal(x.first)) {
+                transition_index[p].push_back(-1);
+            } else {
+                transition_index[p].push_back(int(transitions.size()));
+                transitions.push_back(transition { p, x.first });
+            }
+        }
+    }
+    int root_transition = int(transitions.size());
+    std::vector<lookahead_set> F(
+        transitions.size(), lookahead_set(terminal_count));
+
+    dense_core root_core = make_dense_core(0, 0);
+    for (int p = 0 ; p < int(states.size()) ; p++) {
+        int k = states[p].kernel_index(root_core);
+        if (k < 0) { continue; }
+        transitions.push_back(transition { p, g.left(0) });
+        F.push_back(la[p][k]);
+    }
+
+    // index of the transition (p,X)
+    auto find_transition = [&](int p, int X) {
+        const auto& ts = states[p].transitions;
+        auto i = std::lower_bound(
+            ts.begin(), ts.end(), std::make_pair(X, -1));
+        assert(i != ts.end() && (*i).first == X);
+        return int(i - ts.begin());
+    };
+
+    // DR and reads
+    std::vector<std::vector<int>> R(transitions.size());
+    for (int t = 0 ; t < root_transition ; t++) {
+        int r = states[transitions[t].from].go(transitions[t].label);
+        const auto& ts = states[r].transitions;
+        for (size_t i = 0 ; i < ts.size() ; i++) {
+            int X = ts[i].first;
+            if (g.is_terminal(X)) {
+                F[t].set(X);
+            } else if (first.nullable[X]) {
+                R[t].push_back(transition_index[r][i]);
+            }
+        }
+    }
+
+    // Read
+    digraph(F, R);
+
+    // walks every rule of B from p' for each transition (p',B)
+    auto walk = [&](std::function<void (int, int, int, int)> f) {
+        for (int t = 0 ; t < int(transitions.size()) ; t++) {
+            const auto& tr = transitions[t];
+            auto visit = [&](int rule) {
+                int q = tr.from;
+                int n = g.length(rule);
+                for (int i = 0 ; i < n ; i++) {
+                    f(t, rule, i, q);
+                    q = states[q].go(g.next(make_dense_core(rule, i)));
+                }
+                f(t, rule, n, q);
+            };
+            if (root_transition <= t) {
+                visit(0);
+            } else {
+                for (int rule: g.rules_of(tr.label)) {
+                    visit(rule);
+                }
+            }
+        }
+    };
+
+    // includes
+    for (auto& x: R) { x.clear(); }
+    walk([&](int t, int rule, int i, int q) {
+            dense_core c = make_dense_core(rule, i);
+            int p = g.position(c);
+            int X = g.at(p);
+            if (X < 0 || g.is_terminal(X)) { return; }
+            if (!first.tail_nullable[p + 1]) { return; }
+            R[transition_index[q][find_transition(q, X)]].push_back(t);
+        });
+
+    // Follow
+    digraph(F, R);
+
+    // lookback
+    walk([&](int t, int rule, int i, int q) {
+            if (i == 0) { return; }
+            int k = states[q].kernel_index(make_dense_core(rule, i));
+            assert(0 <= k);
+            la[q][k] |= F[t];
+        });
+}
+
+} // namespace gr
+
+} // namespace zw
+
+#endif // ZW_DEREMER_HPP
@@ -0,0 +1,107 @@
+// Copyright (C) 2006 Naoyuki Hirayama.
+// All Rights Reserved.
+
+// $Id$
+
+#if !defined(ZW_DIGRAPH_HPP)
+#define ZW_DIGRAPH_HPP
+
+// module: digraph
+//   DeRemer & Pennello's digraph algorithm
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+
+namespace zw {
+
+namespace gr {
+
+/*============================================================================
+ *
+ * digraph
+ *
+ * solves F(x) = F'(x) U { F(y) | xRy } for every vertex x.
+ *
+ * F: F'(x) on entry, F(x) on exit.  Set must support '|=' and '='.
+ * R: R[x] is the list of vertices y such that xRy.
+ *
+ * Vertices are visited in Tarjan's order, so each set is merged once per
+ * edge and every member of a strongly connected component ends up with
+ * the same set.  The traversal keeps its own stack; deep relations do
+ * not consume native stack.
+ *
+ *==========================================================================*/
+
+template <class Set>
+void digraph(
+    std::vector<Set>&                       F,
+    const std::vector<std::vector<int>>&    R) {
+
+    const int infinity = (std::numeric_limits<int>::max)();
+
+    struct frame {
+        int     x;
+        int     d;      // depth of x in S when it was pushed
+        size_t  edge;
+    };
+
+    size_t n = F.size();
+    std::vector<int>    N(n, 0);
+    std::vector<int>    S;      // vertices in the current SCC candidates
+    std::vector<frame>  path;   // traversal stack
+
+    for (size_t root = 0 ; root < n ; root++) {
+        if (N[root] != 0) { continue; }
+
+        S.push_back(int(root));
+        N[root] = int(S.size());
+        path.push_back(frame { int(root), N[root], 0 });
+
+        while (!path.empty()) {
+            frame& f = path.back();
+            int x = f.x;
+
+            if (f.edge < R[x].size()) {
+                int y = R[x][f.edge++];
+                if (N[y] == 0) {
+                    // descend
+                    S.push_back(y);
+                    N[y] = int(S.size());
+                    path.push_back(frame { y, N[y], 0 });
+                    continue;
+                }
+                N[x] = (std::min)(N[x], N[y]);
+                F[x] |= F[y];
+                continue;
+            }
+
+            // all edges of x are done
+            int d = f.d;
+            path.pop_back();
+            if (N[x] == d) {
+                // x is the root of an SCC
+                for (;;) {
+                    int z = S.back();
+                    S.pop_back();
+                    N[z] = infinity;
+                    if (z == x) { break; }
+                    F[z] = F[x];
+                }
+            }
+
+            if (!path.empty()) {
+                // resume the caller's edge (x was reached from there)
+                int p = path.back().x;
+                N[p] = (std::min)(N[p], N[x]);
+                F[p] |= F[x];
+            }
+        }
+    }
+}
+
+} // namespace gr
+
+} // namespace zw
+
+#endif // ZW_DIGRAPH_HPP
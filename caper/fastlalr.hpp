@@ -20,6 +20,9 @@
 #include <functional>
 #include "grammar.hpp"
 #include "lr.hpp"
+#include "dense.hpp"
+#include "deremer.hpp"
+#include "parallel.hpp"
 
 //#define ZW_PARSER_LIVECAST
 
@@ -109,157 +112,212 @@ void check_reachable(const grammar<Token, Traits>& g) {
 
 /*============================================================================
  *
- * make_lalr_table
+ * lalr_options
  *
- * LALR(1)\̍쐬
+ * options of make_lalr_table / make_lr1_table; algorithm is for the
+ * caller to choose between them
  *
  *==========================================================================*/
-template <class Token, class Traits, class SRReporter, class RRReporter>
-void 
-make_lalr_table(
-    parsing_table<Token, Traits>&   table,
-    const grammar<Token, Traits>&   g,
-    Token                           error_token,
-    SRReporter                      srr,
-    RRReporter                      rrr) {
-    typedef symbol<Token, Traits>                       symbol_type; 
-    typedef terminal<Token, Traits>                     terminal_type; 
-    typedef rule<Token, Traits>                         rule_type; 
-    typedef lr0_collection<Token, Traits>               lr0_collection_type; 
-    typedef symbol_set<Token, Traits>                   symbol_set_type; 
-    typedef terminal_set<Token, Traits>                 terminal_set_type; 
-    typedef nonterminal_set<Token, Traits>              nonterminal_set_type; 
-    typedef core<Token, Traits>                         core_type; 
-    typedef item<Token, Traits>                         item_type; 
-    typedef item_set<Token, Traits>                     item_set_type; 
-    typedef core_set<Token, Traits>                     core_set_type; 
-    typedef parsing_table<Token, Traits>                parsing_table_type;
-    typedef typename parsing_table_type::state          state_type;
-    typedef typename parsing_table_type::states_type    states_type;
-    typedef typename parsing_table_type::action         action_type;
-    typedef typename state_type::propagate_type         propagate_type;
 
-    // L̎W
-    terminal_set_type terminals;    
-    nonterminal_set_type nonterminals;    
-    symbol_set_type all_symbols;
-    collect_symbols(terminals, nonterminals, all_symbols, g);
-
-    terminal_type dummy("#", Token(-1));
-    terminals.insert(dummy);
-    all_symbols.insert(dummy);
+enum lookahead_algorithm {
+    lookahead_propagation,          // dragon book, algorithm 4.62/4.63
+    lookahead_deremer_pennello,     // reads/includes/lookback relations
+};
 
-    terminal_type eof("$", Traits::eof());
-    terminals.insert(eof);
-    all_symbols.insert(eof);
-        
-    // ڑ`FbN
-    check_reachable(g);
+enum table_algorithm {
+    table_lalr1,                    // make_lalr_table
+    table_minimal_lr1,              // make_lr1_table (honalee.hpp)
+};
 
-    // FIRST, FOLLOW̍쐬
-    first_collection<Token, Traits> first;
-    make_first(first, terminals, g);
+// what a table builder tells of its work when lalr_options::stats is
+// set: phase(name) as each phase starts and phase(nullptr) after the
+// last one, and the size of the automaton the table is made from
+struct lalr_stats {
+    std::function<void (const char*)>   phase;
+    size_t                              states          = 0;
+    size_t                              kernel_items    = 0;
+    size_t                              items           = 0; // closures
+    size_t                              transitions     = 0;
+};
 
-    follow_collection<Token, Traits> follow;
-    make_follow(follow, first, g, eof);
+struct lalr_options {
+    table_algorithm     algorithm   = table_lalr1;
+    lookahead_algorithm lookahead   = lookahead_propagation;
+    int                 threads     = 1;    // 0: all cores
+    lalr_stats*         stats       = nullptr;
+};
 
-    // \̍쐬
-    table.set_grammar(g);
+inline void report_phase(const lalr_options& options, const char* name) {
+    if (options.stats && options.stats->phase) { options.stats->phase(name); }
+}
 
-    // p.271
+inline void report_automaton(
+    const lalr_options&     options,
+    const dense_automaton&  a) {
+    if (!options.stats) { return; }
+
+    lalr_stats& x = *options.stats;
+    x.states = a.states.size();
+    x.kernel_items = x.items = x.transitions = 0;
+    for (const auto& s: a.states) {
+        x.kernel_items += s.kernel.size();
+        x.items += s.cores.size();
+        x.transitions += s.transitions.size();
+    }
+}
 
-    // 1. Construct the kernels of the sets of LR(0) items for G.
-    // If space is not a premium, the simplest way is to construct
-    // the LR(0) sets of items, as in Section 4.6.2, and then
-    // remove the nonkernel items.  If space is serverely
-    // constrained, we may wish instead to store only the kernel
-    // items for each set, and compute GOTO for a set of items I
-    // by first computing the closure of I.
+/*============================================================================
+ *
+ * make_dense_propagation
+ *
+ * step 2 of the propagation method, per state: the lookaheads its kernel
+ * items generate spontaneously for the kernels of its successors, and the
+ * successor kernel items they propagate their own lookaheads to.  States
+ * run on 'threads' threads; todo, if given, limits the work to the states
+ * it flags and leaves the other records as they are.
+ *
+ *==========================================================================*/
 
-    // simplest waŷق
-    lr0_collection_type I;
-    make_lr0_collection(I, g);
-
-    // states
-    states_type& states = table.states();
-
-    // kernels: I(kernel)state̍
-    typedef std::map<core_set_type, int> kernels_type;
-    kernels_type kernels;
-
-    // state, kernels
-    core_type root_core(g.root_rule(), 0);
-    for (const auto& i: I) {
-        // V
-        state_type& s = table.add_state();
-        s.no = int(table.states().size()- 1);
-        s.cores = i;
-        choose_kernel(s.kernel, s.cores, g);
-        kernels[s.kernel] = s.no;
-
-        if (s.kernel.count(root_core)) {
-            table.first_state(s.no);
-            s.generate_map[root_core].insert(eof);
-        }
-    }
+struct dense_propagation {
+    struct generation {
+        int             state;
+        int             item;
+        lookahead_set   lookaheads;
+    };
 
-    // goto_table
-    for (auto& s: states) {
-        for (const auto& symbol: all_symbols) {
-            core_set_type gotoIX;
-            make_lr0_goto(gotoIX, s.cores, symbol, g);
-            if (gotoIX.empty()) { continue; }
+    // per kernel item: the (state, kernel item)s it propagates to
+    std::vector<std::vector<std::pair<int, int>>>   propagate;
+    std::vector<generation>                         generated;
+};
 
-            core_set_type gotoIX2;
-            choose_kernel(gotoIX2, gotoIX, g);
-            s.goto_table[symbol] = kernels[gotoIX2];
-        }
-    }
+template <class Token, class Traits>
+void
+make_dense_propagation(
+    std::vector<dense_propagation>&         p,
+    const dense_automaton&                  a,
+    const dense_grammar<Token, Traits>&     g,
+    const dense_first&                      first,
+    int                                     dummy,
+    const std::vector<char>*                todo = nullptr,
+    int                                     threads = 1) {
+    typedef std::pair<int, int>                         kernel_item_type;
+
+    const auto& states = a.states;
+    p.resize(states.size());
 
     // 2. Apply Algorithm 4.62 to the kernel of each set of LR(0)
     // items and grammar symbol X to determine which lookaheads
     // are spontaneously generated for kernel items in GOTO( I, X
     // ), and from which items in I lookaheads are propagated to
     // kernel items in GOTO( I, X ) .
-        
+
+    // determine lookahead p.296
+    struct scratch {
+        dense_lr1_closure<Token, Traits>                    closure;
+        dense_core_set                                      K;
+        std::vector<lookahead_set>                          K_la;
+        std::vector<std::pair<dense_core, lookahead_set>>   J;
+        std::vector<int>                                    offset;
+        // per transition and kernel item of its destination
+        std::vector<lookahead_set>                          generated;
+    };
+    int workers = worker_count(threads, int(states.size()));
+    std::vector<scratch> scratches(
+        workers,
+        scratch {
+            dense_lr1_closure<Token, Traits>(g, first),
+            dense_core_set(1),
+            std::vector<lookahead_set>(1, lookahead_set(g.terminal_count())),
+            {}, {}, {} });
+    for (auto& x: scratches) { x.K_la[0].set(dummy); }
+
+    parallel_for(int(states.size()), workers, [&](int worker, int s) {
+        if (todo && !(*todo)[s]) { return; }
+
+        scratch& w = scratches[worker];
+        const auto& state = states[s];
+        const auto& kernel = state.kernel;
+        dense_propagation& ps = p[s];
+        ps.propagate.assign(kernel.size(), std::vector<kernel_item_type>());
+        ps.generated.clear();
+
+        w.offset.clear();
+        int n = 0;
+        for (const auto& t: state.transitions) {
+            w.offset.push_back(n);
+            n += int(states[t.second].kernel.size());
+        }
+        w.generated.assign(n, lookahead_set());
+
+        for (size_t k = 0 ; k < kernel.size() ; k++) {
+            w.K[0] = kernel[k];
+            w.closure(w.K, w.K_la);
+            w.closure.items(w.J, w.K, w.K_la);
+
+            for (auto& j: w.J) {
+                int X = g.next(j.first);
+                if (X < 0) { continue; }
+
+                auto ti = std::lower_bound(
+                    state.transitions.begin(), state.transitions.end(),
+                    std::make_pair(X, -1)) - state.transitions.begin();
+                int goto_state = state.transitions[ti].second;
+                int l = states[goto_state].kernel_index(j.first + 1);
+                assert(0 <= l);
+
+                if (j.second.test(dummy)) {
+                    // ǂݓ`d
+                    ps.propagate[k].push_back(kernel_item_type(goto_state, l));
+                    j.second.reset(dummy);
+                }
+                // 
+                if (j.second.none()) { continue; }
+                lookahead_set& dg = w.generated[w.offset[ti] + l];
+                if (dg.empty()) {
+                    dg = j.second;
+                } else {
+                    dg |= j.second;
+                }
+            }
+        }
+
+        for (size_t ti = 0 ; ti < state.transitions.size() ; ti++) {
+            int t = state.transitions[ti].second;
+            for (size_t l = 0 ; l < states[t].kernel.size() ; l++) {
+                lookahead_set& dg = w.generated[w.offset[ti] + l];
+                if (dg.empty()) { continue; }
+                ps.generated.push_back(
+                    dense_propagation::generation { t, int(l), dg });
+            }
+        }
+    });
+}
+
+/*============================================================================
+ *
+ * propagate_dense_lookaheads
+ *
+ * steps 3 and 4 of the propagation method.  la holds per state and
+ * kernel item the lookaheads given in advance (eof for the root item)
+ * and receives the result.
+ *
+ *==========================================================================*/
+
+inline void
+propagate_dense_lookaheads(
+    std::vector<std::vector<lookahead_set>>&    la,
+    const std::vector<dense_propagation>&       p) {
+
     // 3. Initialize a table that gives, for each kernel item in
     // each set of items, the associated lookaheads.  Initially,
     // each item has associated with it only those lookaheads that
     // we determined in step(2) were generated spontaneously.
-
-    // determine lookahead p.296
-    for (auto& s: states) {
-        for (const auto& k: s.kernel) {
-            item_set_type J;
-            J.insert(item_type(k, dummy));
-            make_lr1_closure(J, first, g);
-
-            for (const auto& j: J) {
-                if (j.over()) { continue; }
-
-                const symbol_type& X = j.curr();
-
-                int goto_state = s.goto_table[X];
-                const core_set_type& gotoIX = states[goto_state].kernel;
-
-                for (const auto& l: gotoIX) {
-                    if (!(l.rule() == j.rule())) { continue; }
-                    if (l.cursor() != j.cursor()+ 1) { continue; }
-
-                    if (j.lookahead() == dummy) {
-                        // ǂݓ`d
-                        s.propagate_map[k].insert(
-                            std::make_pair(goto_state, l));
-                    } else {
-                        // 
-                        states[goto_state].generate_map[l].insert(
-                            j.lookahead());
-                    }
-                }                                
-            }
+    for (const auto& x: p) {
+        for (const auto& y: x.generated) {
+            la[y.state][y.item] |= y.lookaheads;
         }
-    }        
-        
+    }
+
     // 4. Make repeated passes over the kernel items in all sets.
     // When we visit an item /i/, we look up the kernel items to
     // which /i/ propagates its lookaheads, using information
@@ -267,156 +325,402 @@ make_lalr_table(
     // /i/ is added to those already associated with each of the
     // items to which items until no more new lookaheads are
     // propagated.
+    //
+    // The passes are done as one digraph traversal over all kernel
+    // items, each taking the lookaheads of the items propagating to it.
+    std::vector<int> offset(la.size() + 1, 0);
+    for (size_t s = 0 ; s < la.size() ; s++) {
+        offset[s+1] = offset[s] + int(la[s].size());
+    }
 
-    bool iterate = true;
-    while (iterate) {
-        iterate = false;
-
-        for (const auto& s: states) {
-            for (const auto& j: s.kernel) {
-                auto f0 = s.generate_map.find(j);
-                if (f0 == s.generate_map.end()) { continue; }
-                auto f1 = s.propagate_map.find(j);
-                if (f1 == s.propagate_map.end()) { continue; }
-
-                const terminal_set_type& sg = (*f0).second;
-                const propagate_type& propagate = (*f1).second;
-
-                for (const auto& k: propagate) {
-                    terminal_set_type& dg =
-                        states[k.first].generate_map[k.second];
-
-                    size_t n = dg.size();
-                    dg.insert(sg.begin(), sg.end());
-                    if (dg.size() != n) { iterate = true; }
-                }
-            }
+    std::vector<lookahead_set> F(offset.back());
+    std::vector<std::vector<int>> R(offset.back());
+    for (size_t s = 0 ; s < la.size() ; s++) {
+        for (size_t j = 0 ; j < la[s].size() ; j++) {
+            F[offset[s] + j].swap(la[s][j]);
         }
     }
-
-    // kernel lr0 collectionɐǂ݂^closure
-    for (auto& s: states) {
-        for (const auto& x: s.kernel) {
-            for (const auto& symbol: s.generate_map[x]) {
-                s.items.insert(item_type(x, symbol));
+    for (size_t s = 0 ; s < p.size() ; s++) {
+        for (size_t j = 0 ; j < p[s].propagate.size() ; j++) {
+            for (const auto& k: p[s].propagate[j]) {
+                R[offset[k.first] + k.second].push_back(offset[s] + int(j));
             }
         }
+    }
+
+    digraph(F, R);
 
-        make_lr1_closure(s.items, first, g);
+    for (size_t s = 0 ; s < la.size() ; s++) {
+        for (size_t j = 0 ; j < la[s].size() ; j++) {
+            la[s][j].swap(F[offset[s] + j]);
+        }
     }
+}
+
+/*============================================================================
+ *
+ * make_propagated_lookaheads
+ *
+ * computes the LALR(1) lookaheads of every kernel item by spontaneous
+ * generation and propagation (dragon book, algorithm 4.63)
+ *
+ *==========================================================================*/
+template <class Token, class Traits>
+void
+make_propagated_lookaheads(
+    std::vector<std::vector<lookahead_set>>&    la,
+    const dense_automaton&                      a,
+    const dense_grammar<Token, Traits>&         g,
+    const dense_first&                          first,
+    int                                         dummy,
+    int                                         threads = 1) {
+    std::vector<dense_propagation> p;
+    make_dense_propagation(p, a, g, first, dummy, nullptr, threads);
+    propagate_dense_lookaheads(la, p);
+}
+
+/*============================================================================
+ *
+ * make_dense_rows
+ *
+ * the actions and gotos of each state in dense numbering, and the
+ * conflicts met while making them, from an automaton whose kernel items
+ * carry their lookaheads (la: per state, per kernel item).  todo as in
+ * make_dense_propagation.
+ *
+ *==========================================================================*/
+
+struct dense_action {
+    int         terminal;
+    action_t    type;
+    int         dest;       // state, for shift
+    int         rule;
+};
+
+struct dense_conflict {
+    bool        shift_reduce;
+    int         x;          // rule of the action in the table
+    int         y;          // rule of the action coming in
+    int         terminal;
+};
+
+struct dense_row {
+    std::vector<dense_action>           actions;    // one per terminal
+    std::vector<std::pair<int, int>>    gotos;      // (nonterminal, state)
+    std::vector<dense_conflict>         conflicts;
+    bool                                root = false;
+};
+
+template <class Token, class Traits>
+void
+make_dense_rows(
+    std::vector<dense_row>&                         rows,
+    const dense_grammar<Token, Traits>&             dg,
+    const dense_first&                              df,
+    const dense_automaton&                          I,
+    const std::vector<std::vector<lookahead_set>>&  la,
+    const std::vector<char>*                        todo = nullptr,
+    int                                             threads = 1) {
+    typedef rule<Token, Traits>                         rule_type;
+
+    dense_core root_core = make_dense_core(0, 0);
+    int eof = dg.terminal_id(Traits::eof());
+    const rule_type& root_rule = dg.rule(0);
+
+    struct scratch {
+        dense_lr1_closure<Token, Traits>                    closure;
+        std::vector<std::pair<dense_core, lookahead_set>>   items;
+        std::vector<int>                                    action_of;
+    };
+    int workers = worker_count(threads, int(I.states.size()));
+    std::vector<scratch> scratches(
+        workers,
+        scratch {
+            dense_lr1_closure<Token, Traits>(dg, df),
+            {},
+            std::vector<int>(dg.terminal_count(), -1) });
+
+    rows.resize(I.states.size());
 
     // iɂ\͓J(i)B
     // A̓\ɋ΁A^ꂽ@
     // LALR(1)łȂA\̓[`oƂ͂łȂB
-    for (auto& s: states) {
+    parallel_for(int(I.states.size()), workers, [&](int worker, int i) {
+        if (todo && !(*todo)[i]) { return; }
+
+        const dense_state& ds = I.states[i];
+        dense_row& row = rows[i];
+        row = dense_row();
+        auto& closure = scratches[worker].closure;
+        auto& items = scratches[worker].items;
+        auto& action_of = scratches[worker].action_of;
+
+        auto set_action = [&](int t, action_t type, int dest, int r) {
+            if (action_of[t] < 0) {
+                action_of[t] = int(row.actions.size());
+                row.actions.push_back(dense_action { t, type, dest, r });
+            } else {
+                row.actions[action_of[t]] = dense_action { t, type, dest, r };
+            }
+        };
+
+        // kernel lr0 collectionɐǂ݂^closure
+        closure(ds.kernel, la[i]);
+        closure.items(items, ds.kernel, la[i]);
+
         // p287
         // a) [AEa,b]J(i)̗vfłA
         // goto(J(i),a)=J(j)ł΁A
         // action[i,a]ɓ"shift j"B
         // ŁAa͏I[LłȂ΂ȂȂB
-        for (const item_type& x: s.items) {
-            if (x.over()) { continue; }
-
-            const symbol_type& a = x.curr();
-            if (!a.is_terminal()) { continue; }
+        for (const auto& x: items) {
+            if (x.second.none()) { continue; }
 
-            auto gt = s.goto_table.find(a);
-            if (gt == s.goto_table.end()) { continue; }
+            int a = dg.next(x.first);
+            if (a < 0 || !dg.is_terminal(a)) { continue; }
+            if (0 <= action_of[a]) { continue; }
 
-            int next = (*gt).second;
-                        
-            // terminalgoto_table폜
-            s.goto_table.erase(gt);
-
-            // shift
-            auto k = s.action_table.find(a.token());
-            if (k != s.action_table.end()) {
-                if ((*k).second.type == action_reduce) {
-                    srr(x.rule(), (*k).second.rule);
-                }
-            }
-
-            s.action_table[a.token()] = action_type(
-                action_shift, next, x.rule());
+            set_action(a, action_shift, ds.go(a), dense_rule(x.first));
         }
 
         // b), c)͓ɍs
-        for (const item_type& x: s.items) {
-            if (!x.over()) { continue; }
-
-            // conflictłacceptreducëƂ݂Ȃ
-            bool add_action = true;
-
-            auto k = s.action_table.find(x.lookahead().token());
-            if (k != s.action_table.end()) {
-                const rule_type& krule = (*k).second.rule;
-                if ((*k).second.type == action_shift) {
-                    srr(krule, x.rule());
-                    add_action = false; // shiftD
+        for (const auto& x: items) {
+            if (0 <= dg.next(x.first)) { continue; }
+
+            int r = dense_rule(x.first);
+            const rule_type& rule = dg.rule(r);
+
+            for (size_t b = x.second.find_first() ;
+                 b != lookahead_set::npos ;
+                 b = x.second.find_next(b)) {
+                // conflictłacceptreducëƂ݂Ȃ
+                bool add_action = true;
+
+                int k = action_of[b];
+                if (0 <= k) {
+                    const dense_action& ka = row.actions[k];
+                    const rule_type& krule = dg.rule(ka.rule);
+                    if (ka.type == action_shift) {
+                        row.conflicts.push_back(
+                            dense_conflict { true, ka.rule, r, int(b) });
+                        add_action = false; // shiftD
+                    }
+                    if (ka.type == action_reduce && !(krule == rule)) {
+                        row.conflicts.push_back(
+                            dense_conflict { false, ka.rule, r, int(b) });
+                        // ႢD
+                        add_action = rule.id() < krule.id();
+                    }
                 }
-                if ((*k).second.type == action_reduce &&
-                    !(krule == x.rule())) {
-                    rrr(krule, x.rule());
-                    // ႢD
-                    add_action = x.rule().id() < (*k).second.rule.id(); 
+
+                if (!add_action) { continue; }
+
+                if (rule == root_rule) {
+                    // c)[S'SE, $]Ji̗vfȂ΁A
+                    // action[i, $]"accept"B
+                    set_action(eof, action_accept, -1, 0);
+                } else {
+                    // b)[AE, a]Ji̗vfłA
+                    // ASȂ΁Aaction[i, a]
+                    // "reduce A"B
+                    set_action(int(b), action_reduce, -1, r);
                 }
             }
-
-            if (!add_action) { continue; }
-
-            if (x.rule() == g.root_rule()) {
-                // c)[S'SE, $]Ji̗vfȂ΁A
-                // action[i, $]"accept"B
-
-                s.action_table[Traits::eof()] = action_type(
-                    action_accept, 0xdeadbeaf, g.root_rule());
-            } else {
-                // b)[AE, a]Ji̗vfłA
-                // ASȂ΁Aaction[i, a]
-                // "reduce A"B
-
-                s.action_table[x.lookahead().token()] = action_type(
-                    action_reduce, 0xdeadbeaf, x.rule());
-            }                    
         }
 
         // iɑ΂s֐́A
         // ̋KׂĂ̔I[LAɓKpč쐬B
         // Ȃ킿Agoto(I(i),A)=I(j)ł΁Agoto[i,A]=jƂB
-        for (const auto& A: nonterminals) {
-            item_set_type gt2;
-            make_lr1_goto(gt2, s.items, symbol_type(A), first, g);
+        for (const auto& x: items) {
+            if (x.second.none()) { continue; }
 
-            core_set_type gt;
-            items_to_cores(gt, gt2);
+            int A = dg.next(x.first);
+            if (A < 0 || dg.is_terminal(A)) { continue; }
 
-            auto next = kernels.find(gt);
-            if (next == kernels.end()) { continue; }
-            s.goto_table[A] = (*next).second;
+            row.gotos.push_back(std::make_pair(A, ds.go(A)));
         }
-    }
-
-    // Ԃ̌
-    for (const auto& s: table.states()) {
-        // [g@ǂ̃`FbN
-        for (const auto& item: s.items) {
-            if (item.cursor() == 0 && item.rule() == g.root_rule()) {
-                table.first_state(s.no);
+        std::sort(row.gotos.begin(), row.gotos.end());
+        row.gotos.erase(
+            std::unique(row.gotos.begin(), row.gotos.end()),
+            row.gotos.end());
+
+        // Ԃ̌
+        for (const auto& x: items) {
+            if (x.first == root_core && x.second.any()) {
+                row.root = true;
             }
         }
+
+        for (const auto& x: row.actions) { action_of[x.terminal] = -1; }
+    });
+}
+
+/*============================================================================
+ *
+ * fill_parsing_table
+ *
+ * makes the actions and gotos of table from dense rows, and reports the
+ * conflicts met in state order
+ *
+ *==========================================================================*/
+template <class Token, class Traits, class SRReporter, class RRReporter>
+void
+fill_parsing_table(
+    parsing_table<Token, Traits>&               table,
+    const dense_grammar<Token, Traits>&         dg,
+    const std::vector<dense_row>&               rows,
+    Token                                       error_token,
+    SRReporter                                  srr,
+    RRReporter                                  rrr,
+    int                                         threads = 1) {
+    typedef parsing_table<Token, Traits>                parsing_table_type;
+    typedef typename parsing_table_type::state          state_type;
+    typedef typename parsing_table_type::action         action_type;
+
+    for (size_t i = 0 ; i < rows.size() ; i++) {
+        table.add_state();
     }
+    auto& states = table.states();
+
+    parallel_for(int(rows.size()), threads, [&](int, int i) {
+        const dense_row& row = rows[i];
+        state_type& s = states[i];
+
+        for (const auto& a: row.actions) {
+            s.action_table[dg.symbol(a.terminal).token()] = action_type(
+                a.type,
+                a.type == action_shift ? a.dest : 0xdeadbeaf,
+                dg.rule(a.rule));
+        }
+        for (const auto& x: row.gotos) {
+            s.goto_table[dg.symbol(x.first)] = x.second;
+        }
 
-    // G[Ԃǂ̔
-    for (auto& s: table.states()) {
-        // [g@ǂ̃`FbN
-        for (const auto& pair: s.action_table) {
-            if (pair.first == error_token) {
-                s.handle_error = true;
-                break;
+        // G[Ԃǂ̔
+        s.handle_error = s.action_table.count(error_token) != 0;
+    });
+
+    for (size_t i = 0 ; i < rows.size() ; i++) {
+        for (const auto& x: rows[i].conflicts) {
+            if (x.shift_reduce) {
+                srr(dg.rule(x.x), dg.rule(x.y));
+            } else {
+                rrr(dg.rule(x.x), dg.rule(x.y));
             }
+
+            // the action the conflict resolved away: the reduction losing
+            // to a shift, or to a reduction by a younger rule
+            int r = !x.shift_reduce &&
+                dg.rule(x.y).id() < dg.rule(x.x).id() ? x.x : x.y;
+            states[i].alternative_table.insert(
+                std::make_pair(
+                    dg.symbol(x.terminal).token(),
+                    action_type(
+                        r == 0 ? action_accept : action_reduce,
+                        0xdeadbeaf,
+                        dg.rule(r))));
+        }
+        if (rows[i].root) {
+            table.first_state(int(i));
         }
     }
+}
+
+template <class Token, class Traits, class SRReporter, class RRReporter>
+void
+fill_parsing_table(
+    parsing_table<Token, Traits>&                   table,
+    const dense_grammar<Token, Traits>&             dg,
+    const dense_first&                              df,
+    const dense_automaton&                          I,
+    const std::vector<std::vector<lookahead_set>>&  la,
+    Token                                           error_token,
+    SRReporter                                      srr,
+    RRReporter                                      rrr,
+    int                                             threads) {
+    std::vector<dense_row> rows;
+    make_dense_rows(rows, dg, df, I, la, nullptr, threads);
+    fill_parsing_table(table, dg, rows, error_token, srr, rrr, threads);
+}
+
+/*============================================================================
+ *
+ * make_lalr_table
+ *
+ * LALR(1)\̍쐬
+ *
+ *==========================================================================*/
+template <class Token, class Traits, class SRReporter, class RRReporter>
+void 
+make_lalr_table(
+    parsing_table<Token, Traits>&   table,
+    const grammar<Token, Traits>&   g,
+    Token                           error_token,
+    SRReporter                      srr,
+    RRReporter                      rrr,
+    const lalr_options&             options = lalr_options()) {
+    typedef terminal<Token, Traits>                     terminal_type; 
+    typedef dense_grammar<Token, Traits>                dense_grammar_type;
+
+    terminal_type dummy("#", Token(-1));
+    terminal_type eof("$", Traits::eof());
+        
+    report_phase(options, "FIRST");
+
+    // ڑ`FbN
+    check_reachable(g);
+
+    // LEK̐
+    dense_grammar_type dg(g, std::vector<terminal_type> { dummy, eof });
+
+    // FIRST̍쐬
+    dense_first df;
+    make_dense_first(df, dg);
+
+    // \̍쐬
+    table.set_grammar(g);
+
+    // p.271
+
+    // 1. Construct the kernels of the sets of LR(0) items for G.
+    // If space is not a premium, the simplest way is to construct
+    // the LR(0) sets of items, as in Section 4.6.2, and then
+    // remove the nonkernel items.  If space is serverely
+    // constrained, we may wish instead to store only the kernel
+    // items for each set, and compute GOTO for a set of items I
+    // by first computing the closure of I.
+
+    // simplest waŷق
+    report_phase(options, "LR(0)");
+    dense_automaton I;
+    make_dense_lr0_automaton(I, dg);
+    report_automaton(options, I);
+
+    // lookahead
+    report_phase(options, "lookahead");
+    int eof_id = dg.terminal_id(eof.token());
+    dense_core root_core = make_dense_core(0, 0);
+
+    std::vector<std::vector<lookahead_set>> la(I.states.size());
+    for (size_t i = 0 ; i < I.states.size() ; i++) {
+        const dense_state& s = I.states[i];
+        la[i].assign(s.kernel.size(), lookahead_set(dg.terminal_count()));
+
+        int k = s.kernel_index(root_core);
+        if (0 <= k) { la[i][k].set(eof_id); }
+    }
+
+    if (options.lookahead == lookahead_deremer_pennello) {
+        make_deremer_lookaheads(la, I, dg, df);
+    } else {
+        make_propagated_lookaheads(
+            la, I, dg, df, dg.terminal_id(dummy.token()), options.threads);
+    }
 
+    report_phase(options, "fill");
+    fill_parsing_table(
+        table, dg, df, I, la, error_token, srr, rrr, options.threads);
+    report_phase(options, nullptr);
 }
 
 template <class Token, class Traits>
@@ -524,7 +828,7 @@ public:
                     ate = true;
                     break;
                 case action_reduce: {
-                    const auto& rule = action->rule;
+                    const auto& rule = table_.rule(*action);
                     value_type v;
                     run_semantic_action(v, rule);
                     pop_stack(rule.right().size());
@@ -537,7 +841,7 @@ public:
                     break;
                 }
                 case action_accept: {
-                    const auto& rule = action->rule;
+                    const auto& rule = table_.rule(*action);
                     run_semantic_action(accept_value_, rule);
                     return true;
                 }
@@ -569,7 +873,7 @@ private:
         stack_.erase(stack_.end() - n, stack_.end());
     }
 
-    typename table_type::state* stack_top() {
+    const state_type* stack_top() const {
         return &table_.states()[stack_.back().state];
     }
 
@@ -589,7 +893,8 @@ struct package {
     typedef zw::gr::symbol<Token, Traits>            symbol;
     typedef zw::gr::grammar<Token, Traits>           grammar;
     typedef zw::gr::parsing_table<Token, Traits>     parsing_table;
-    typedef zw::gr::parser<parsing_table, Value>     parser;
+    typedef zw::gr::compact_table<Token, Traits>     compact_table;
+    typedef zw::gr::parser<compact_table, Value>     parser;
 
     static void make_lalr_table(
         parsing_table&  table,
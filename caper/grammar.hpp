@@ -176,8 +176,10 @@ public:
         return *this;
     }
 
+    // by name, not by the address it is interned at, so that whatever
+    // is ordered by nonterminals comes out the same from run to run
     int cmp(const nonterminal<Token, Traits>& y) const {
-        return name_ - y.name_;
+        return name_ == y.name_ ? 0 : name_->compare(*y.name_);
     }
 
 private:
@@ -260,15 +262,17 @@ private:
     };
 
 public:
-    symbol() : type_( type_epsilon ) {}
+    symbol() : type_(type_epsilon), token_(Traits::eof()), name_(nullptr) {}
     symbol(const symbol<Token, Traits>& x)
         : type_(x.type_),
           token_(x.token_), display_(x.display_), name_(x.name_) {}
-    symbol(const epsilon<Token, Traits>&) : type_(type_epsilon) {}
+    symbol(const epsilon<Token, Traits>&)
+        : type_(type_epsilon), token_(Traits::eof()), name_(nullptr) {}
     symbol(const terminal<Token, Traits>& x)
-        : type_(type_terminal), token_(x.token_), display_(x.display_) {}
+        : type_(type_terminal), token_(x.token_), display_(x.display_),
+          name_(nullptr) {}
     symbol(const nonterminal<Token, Traits>& x)
-        : type_(type_nonterminal), name_(x.name_) {}
+        : type_(type_nonterminal), token_(Traits::eof()), name_(x.name_) {}
 
     symbol<Token, Traits>& operator=(const symbol<Token, Traits>& x) {
         type_ = x.type_;
@@ -328,7 +332,8 @@ public:
         switch (type_) {
             case symbol_type::type_epsilon:      return 0;
             case symbol_type::type_terminal:     return token_ - y.token_;
-            case symbol_type::type_nonterminal:  return name_ - y.name_;
+            case symbol_type::type_nonterminal:
+                return name_ == y.name_ ? 0 : name_->compare(*y.name_);
             default: assert(0);     return 0;
         }
     }
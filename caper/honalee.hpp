@@ -1,263 +1,194 @@
 #ifndef HONALEE_HPP
 #define HONALEE_HPP
 
-#include "lr.hpp"
+// module: honalee
+//   minimal LR(1) table
+
+#include <vector>
 #include <deque>
-#include <boost/shared_ptr.hpp>
+#include <unordered_map>
+#include "fastlalr.hpp"
 
 namespace zw {
 
 namespace gr {
 
-////////////////////////////////////////////////////////////////
-// tmp
+/*============================================================================
+ *
+ * weakly_compatible
+ *
+ * Pager's weak compatibility of two lookahead assignments to the same
+ * kernel.  Merging compatible states never introduces a reduce/reduce
+ * conflict that canonical LR(1) would not have:
+ *
+ *   for every i != j,
+ *     (a[i] & b[j]) = (b[i] & a[j]) = {}, or
+ *     (a[i] & a[j]) != {}, or (b[i] & b[j]) != {}
+ *
+ *==========================================================================*/
 
-template <class T>
-void print_headline( const char* h, const T& v, const char* p )
-{
-    std::cerr << h << ":";
-    for( typename T::const_iterator i = v.begin() ; i != v.end() ; ++i ) {
-        std::cerr << " " << p << (*i)->number;
-    }
-    std::cerr << std::endl;
-}
+inline bool weakly_compatible(
+    const std::vector<lookahead_set>&   a,
+    const std::vector<lookahead_set>&   b) {
 
-template < class Set, class Token, class Traits >
-void
-make_honalee_closure(
-    Set&                                            J,
-    const first_collection< Token, Traits >&        first,        
-    const grammar<Token,Traits>&                    g)
-{
-    typedef symbol< Token, Traits >                 symbol_type;
-    typedef rule< Token, Traits >                   rule_type;
-    typedef grammar< Token, Traits >                grammar_type;
-    typedef item< Token, Traits >                   item_type;
-    typedef symbol_set< Token, Traits >             symbol_set_type;
-    //typedef item_set< Token, Traits >               item_set_type;
-    typedef std::vector< symbol< Token, Traits >  > symbol_vector_type;
-
-    Set I = J;
-
-    int m = 0;
-    for(;;){
-        Set new_items;  // }鍀
-
-        m++;
-#if 0
-        std::cerr << "* Closure Iteration: " << m << std::endl;
-#endif
-                
-        for( typename Set::const_iterator i = I.begin() ; i != I.end() ; ++i ) {
-            // x is [item(AEB,a)]
-            const item_type& x = (*i);
-            if( x.over() ){ continue; }
-
-#if 0
-            std::cerr << "  - test: " << x << std::endl;
-#endif
-
-            // y is [symbol(B)]
-            const symbol_type& y = x.curr();
-            if( !y.is_nonterminal() ) { continue; }
-
-            // v is [symbol_vector_type(a)]
-            symbol_vector_type v;
-            for( int j = x.cursor() + 1 ; j < int( x.rule().right().size() ) ; j++ ) {
-                v.push_back( x.rule().right()[j] );
+    size_t n = a.size();
+    for (size_t i = 0 ; i < n ; i++) {
+        for (size_t j = i + 1 ; j < n ; j++) {
+            if (!a[i].intersects(b[j]) && !b[i].intersects(a[j])) {
+                continue;
             }
-            v.push_back( x.lookahead() );
-
-            // f is FIRST(a)
-            symbol_set_type f;
-            make_vector_first( f, first, v ); 
-
-            for( typename grammar_type::const_iterator j = g.begin() ; j != g.end() ; ++j ) {
-                // z is [rule(B)]
-                const rule_type& z = (*j);
-                if( !(  symbol_type( z.left() ) == y ) ) { continue; }
-
-                // elookahead
-                for( typename symbol_set_type::const_iterator k = f.begin() ; k != f.end() ; ++k ) {
-                    item_type item( z, 0, *k );
-                    if( J.find( item ) == J.end() ) {
-                        new_items.insert( item );
-                    }
-                }
+            if (a[i].intersects(a[j]) || b[i].intersects(b[j])) {
+                continue;
             }
+            return false;
         }
-
-        if( new_items.empty() ) { break; }
-        J.insert( new_items.begin(), new_items.end() );
-        I.swap( new_items );
-    }
-}
-
-template < class T >
-void print_list_indirect( std::ostream& os, const T& x )
-{
-    for( typename T::const_iterator i = x.begin() ; i != x.end() ; ++i ) {
-        os << **i;
     }
+    return true;
 }
 
-////////////////////////////////////////////////////////////////
-// from here
-template < class Token, class Traits >
-struct state;
-
-template < class Token, class Traits >
-struct mark {
-    typedef symbol< Token, Traits >                         symbol_type; 
-    typedef rule< Token, Traits >                           rule_type;
-    typedef item< Token, Traits >                           item_type;
-    typedef boost::shared_ptr< state< Token, Traits > >     state_ptr;
-
-    bool kernel;
-    enum { action_nil, action_shift, action_reduce } action;
-
-    // when action_reduce
-    rule_type       reduce_rule;
-
-    // when action_shift
-    symbol_type     shift_symbol;
-    state_ptr       goto_state;
+/*============================================================================
+ *
+ * make_minimal_lr1_automaton
+ *
+ * LR(1) automaton built the way Honalee builds it, state by state with
+ * lookaheads attached, merging a new state into an existing one with the
+ * same kernel whenever the two are weakly compatible.  A state whose
+ * lookaheads grow through a merge is processed again, and may then
+ * redirect its transitions; states nobody reaches any more are dropped
+ * at the end.  The result has LALR(1) size on LALR(1) grammars and
+ * splits states only where LALR(1) merging would cause a conflict.
+ *
+ *==========================================================================*/
 
-    mark() : action( action_nil ) {}
-    mark( bool k ) : kernel( k ), action( action_nil ) {}
+template <class Token, class Traits>
+void make_minimal_lr1_automaton(
+    dense_automaton&                            a,
+    std::vector<std::vector<lookahead_set>>&    la,
+    const dense_grammar<Token, Traits>&         g,
+    const dense_first&                          first,
+    int                                         eof) {
+
+    std::vector<dense_state> states;
+    std::vector<std::vector<lookahead_set>> lookaheads;
+    std::unordered_map<dense_core_set, std::vector<int>, dense_core_set_hash>
+        by_kernel;
+    std::deque<int> queue;
+    std::vector<char> queued;
+
+    auto add_state = [&](
+        const dense_core_set& K, const std::vector<lookahead_set>& L) {
+        int n = int(states.size());
+        states.push_back(dense_state());
+        states.back().kernel = K;
+        lookaheads.push_back(L);
+        by_kernel[K].push_back(n);
+        queue.push_back(n);
+        queued.push_back(1);
+        return n;
+    };
+
+    // the destination of a transition that carries K with L
+    auto intern = [&](
+        const dense_core_set& K, const std::vector<lookahead_set>& L) {
+        auto i = by_kernel.find(K);
+        if (i != by_kernel.end()) {
+            for (int t: (*i).second) {
+                auto& M = lookaheads[t];
+                if (!weakly_compatible(M, L)) { continue; }
+
+                bool changed = false;
+                for (size_t k = 0 ; k < M.size() ; k++) {
+                    if (!L[k].is_subset_of(M[k])) {
+                        M[k] |= L[k];
+                        changed = true;
+                    }
+                }
+                if (changed && !queued[t]) {
+                    queued[t] = 1;
+                    queue.push_back(t);
+                }
+                return t;
+            }
+        }
+        return add_state(K, L);
+    };
 
-    void markNil()
     {
-        action = action_nil;
-        goto_state.reset();
+        std::vector<lookahead_set> L(1, lookahead_set(g.terminal_count()));
+        L[0].set(eof);
+        add_state(dense_core_set { make_dense_core(0, 0) }, L);
     }
-    void markShift( const symbol_type& x, state_ptr y )
-    {
-        action = action_shift;
-        shift_symbol = x;
-        goto_state = y;
-    }
-    void markReduce( const rule_type& y )
-    {
-        action = action_reduce;
-        reduce_rule = y;
-        goto_state.reset();
-    }
-};
-
-template < class Token, class Traits >
-std::ostream& operator<<( std::ostream& os, const mark< Token, Traits >& i )
-{
-    if( i.kernel ) { os << "* "; } else { os <<  "  "; }
-    os << "( ";
-    switch( i.action ) {
-    case mark< Token, Traits >::action_nil:
-        os << "-, -"; break;
-    case mark< Token, Traits >::action_shift:
-        os << i.shift_symbol << ", " << i.goto_state->number; break;
-    case mark< Token, Traits >::action_reduce:
-        os << ", " << i.reduce_rule; break;
-    }
-    os << " )";
-    return os;
-}
 
-template < class Token, class Traits >
-struct state {
-    typedef std::map< item< Token, Traits >, mark< Token, Traits > > items_type;
-
-    items_type      items;
-    int             number;
-    bool            complete;
-};
-
-template < class Token, class Traits >
-std::ostream& operator<<( std::ostream& os, const state< Token, Traits >& s )
-{
-    os << s.number << ": " << "{\n";
-    for( typename state< Token, Traits >::items_type::const_iterator i = s.items.begin() ;
-         i != s.items.end() ;
-         ++i ) {
-        os << "    [ " << (*i).first << "]" << (*i).second << std::endl;
-    }
-    os << "}\n";
-    return os;
-}
-
-template < class Token, class Traits  >
-bool equal_core( const state< Token, Traits >& x,
-                 const state< Token, Traits >& y )
-{
-    typedef core_set< Token, Traits >       core_set_type;
-    typedef state< Token, Traits >          state_type;
-
-    core_set_type x0;
-    core_set_type y0;
-    for( typename state_type::items_type::const_iterator i = x.items.begin() ; i != x.items.end() ; ++i ) {
-        if( !(*i).second.kernel ) { continue; }
-        x0.insert( (*i).first.core() );
-    }
+    dense_lr1_closure<Token, Traits> closure(g, first);
+    std::vector<std::pair<dense_core, lookahead_set>> items;
+    std::vector<dense_core_set> kernels(g.symbol_count());
+    std::vector<std::vector<lookahead_set>> kernel_la(g.symbol_count());
+    std::vector<int> symbols;
+
+    while (!queue.empty()) {
+        int s = queue.front();
+        queue.pop_front();
+        queued[s] = 0;
+
+        dense_core_set kernel = states[s].kernel;
+        std::vector<lookahead_set> L = lookaheads[s];
+        closure(kernel, L);
+        closure.items(items, kernel, L);
+
+        // successors; items are sorted by core, and so is each kernel
+        symbols.clear();
+        dense_core_set cores;
+        for (const auto& x: items) {
+            cores.push_back(x.first);
+
+            int X = g.next(x.first);
+            if (X < 0) { continue; }
+            if (kernels[X].empty()) { symbols.push_back(X); }
+            kernels[X].push_back(x.first + 1);
+            kernel_la[X].push_back(x.second);
+        }
+        std::sort(symbols.begin(), symbols.end());
+
+        std::vector<std::pair<int, int>> transitions;
+        for (int X: symbols) {
+            transitions.push_back(
+                std::make_pair(X, intern(kernels[X], kernel_la[X])));
+            kernels[X].clear();
+            kernel_la[X].clear();
+        }
 
-    for( typename state_type::items_type::const_iterator i = y.items.begin() ; i != y.items.end() ; ++i ) {
-        if( !(*i).second.kernel ) { continue; }
-        y0.insert( (*i).first.core() );
+        states[s].cores = std::move(cores);
+        states[s].transitions = std::move(transitions);
     }
 
-    return x0 == y0;
-}
-
-template < class Token, class Traits  >
-bool rrconflict( const state< Token, Traits >& x,
-                 const state< Token, Traits >& y )
-{
-    //typedef core_set< Token, Traits >       core_set_type;
-    typedef mark< Token, Traits >           mark_type;
-    typedef state< Token, Traits >          state_type;
-
-    for( typename state_type::items_type::const_iterator i = x.items.begin() ;
-         i != x.items.end() ;
-         ++i ) {
-        if( (*i).second.action != mark_type::action_reduce ) { continue; }
-
-        for( typename state_type::items_type::const_iterator j = y.items.begin() ;
-             j != y.items.end() ;
-             ++j ) {
-            if( (*j).second.action != mark_type::action_reduce ) { continue; }
-
-            if( (*j).first.lookahead() == (*i).first.lookahead() &&
-                ! ( (*j).second.reduce_rule == (*i).second.reduce_rule ) ) {
-                return true;
+    // drop unreachable states, keeping the order of creation
+    std::vector<int> renumber(states.size(), -1);
+    std::vector<int> stack { 0 };
+    renumber[0] = 0;
+    while (!stack.empty()) {
+        int s = stack.back();
+        stack.pop_back();
+        for (const auto& t: states[s].transitions) {
+            if (renumber[t.second] < 0) {
+                renumber[t.second] = 0;
+                stack.push_back(t.second);
             }
         }
     }
-    return false;
-}
-
-template < class Token, class Traits  >
-void merge( bool&                               added_items,
-            bool&                               added_shift_items,
-            state< Token, Traits >&             x,
-            const state< Token, Traits >&       y )
-{
-    //typedef core_set< Token, Traits >       core_set_type;
-    //typedef mark< Token, Traits >           mark_type;
-    typedef state< Token, Traits >          state_type;
-
-    added_items = false;
-    added_shift_items = false;
-
-    for( typename state_type::items_type::const_iterator i = y.items.begin() ;
-         i != y.items.end() ;
-         ++i ) {
-
-        if( x.items.find( (*i).first ) != x.items.end() ) { continue; }
-
-        x.items[(*i).first] = (*i).second;
-        added_items = true;
+    int n = 0;
+    for (auto& x: renumber) {
+        if (0 <= x) { x = n++; }
+    }
 
-        if( !(*i).first.over() ) {
-            added_shift_items = true;
+    a.states.clear();
+    la.clear();
+    for (size_t s = 0 ; s < states.size() ; s++) {
+        if (renumber[s] < 0) { continue; }
+        for (auto& t: states[s].transitions) {
+            t.second = renumber[t.second];
         }
+        a.states.push_back(std::move(states[s]));
+        la.push_back(std::move(lookaheads[s]));
     }
 }
 
@@ -265,346 +196,58 @@ void merge( bool&                               added_items,
  *
  * make_lr1_table
  *
- * LR(1)\̍쐬 ( honalee algorithm )
+ * LR(1)表の作成
  *
  *==========================================================================*/
-template < class Token, class Traits , class SRReporter, class RRReporter >
+
+template <class Token, class Traits, class SRReporter, class RRReporter>
 void
 make_lr1_table(
-    parsing_table< Token, Traits >& table,
-    const grammar< Token, Traits >& g,
+    parsing_table<Token, Traits>&   table,
+    const grammar<Token, Traits>&   g,
+    Token                           error_token,
     SRReporter                      srr,
-    RRReporter                      rrr )
-{
-    typedef terminal< Token, Traits >       terminal_type; 
-    typedef symbol< Token, Traits >         symbol_type; 
-    typedef symbol_set< Token, Traits >     symbol_set_type; 
-    typedef rule< Token, Traits >           rule_type; 
-    typedef grammar< Token, Traits >        grammar_type; 
-    typedef item< Token, Traits >           item_type; 
-    typedef item_set< Token, Traits >       item_set_type; 
-    typedef mark< Token, Traits >           mark_type;
-    typedef state< Token, Traits >          state_type;
-    typedef boost::shared_ptr< state_type > state_ptr;
-    typedef parsing_table< Token, Traits >  parsing_table_type;
-
-    terminal_type eof( "$", Traits::eof() );
-
-    // L̎W
-    symbol_set_type terminals;    
-    symbol_set_type nonterminals;    
-    symbol_set_type all_symbols;
-    collect_symbols( terminals, nonterminals, all_symbols, g );
-
-    // FIRST, FOLLOW̍쐬
-    first_collection< Token, Traits > first;
-    follow_collection< Token, Traits > follow;
-    make_first_and_follow( first, follow, terminals, nonterminals, all_symbols, g );
-
-    std::deque< state_ptr >       doneList;
-    std::deque< state_ptr >       incList;
-    std::deque< state_ptr >       toDoList;
-    state_ptr                     comeFrom;
-    int setCount = 0;
-
-    state_ptr i0( new state_type );
-    i0->items[item_type( g.root_rule(), 0, eof )] = mark_type( true );
-    i0->number = -1;
-    i0->complete = false;
-    toDoList.push_back( i0 );
+    RRReporter                      rrr,
+    const lalr_options&             options = lalr_options()) {
+    typedef terminal<Token, Traits>                     terminal_type;
+    typedef dense_grammar<Token, Traits>                dense_grammar_type;
 
-    int n = 0;
-
-    while( !incList.empty() || !toDoList.empty() ) {
-        // phase 1
-#if 0
-        std::cerr << "<<< Iteration " << (n+1) << ", PHASE 1 >>>\n";
-#endif
-
-        comeFrom.reset();
-        if( !incList.empty() ) {
-            state_ptr s = incList.front(); incList.pop_front();
-            comeFrom = s;
-
-#if 0
-            std::cerr << "incList.top\n";
-            std::cerr << *s;
-#endif
-                        
-            for( typename state_type::items_type::iterator i = s->items.begin() ;
-                 i != s->items.end() ;
-                 ++i ) {
-                const item_type& item = (*i).first;
-                const mark_type& mark = (*i).second;
-                if( mark.action != mark_type::action_nil )      { continue; }
-                if( item.over() )                               { continue; }
-                                
-                const symbol_type& S = item.curr();
-                state_ptr newSet( new state_type );
-                newSet->number = -1;
-                newSet->complete = false;
-                toDoList.push_back( newSet );
-                                
-                for( typename state_type::items_type::iterator j = s->items.begin() ;
-                     j != s->items.end() ;
-                     ++j ) {
-                    const item_type& shItem = (*j).first;
-                    mark_type& shMark = (*j).second;
-                    if( shItem.over() )           { continue; }
-                    if( !( shItem.curr() == S ) ) { continue; }
-                                        
-                    newSet->items[
-                        item_type(
-                            shItem.rule(),
-                            shItem.cursor()+1,
-                            shItem.lookahead() ) ] =
-                        mark_type( true );
-                                        
-                    shMark.markShift( S, newSet );
-                }
-
-#if 0
-                std::cerr << "newSet:\n" << *newSet;
-#endif
-            }
-                        
-            s->complete = true;
-            doneList.push_back( s );
-        }
-                
-#if 0
-        print_headline( "doneList", doneList, "i" );
-        print_headline( " incList", incList, "i" );
-        print_headline( "toDoList", toDoList, "i" );
-
-        std::cerr << "<doneList>\n";
-        print_list_indirect( std::cerr, doneList );
-        std::cerr << "<incList>\n";
-        print_list_indirect( std::cerr, incList );
-        std::cerr << "<toDoList>\n";
-        print_list_indirect( std::cerr, toDoList );
-#endif
-
-        // phase 2
-#if 0
-        std::cerr << "<<< Iteration " << (n+1) << ", PHASE 2 >>>\n";
-#endif
-
-        while( !toDoList.empty() ) {
-            state_ptr s = toDoList.front(); toDoList.pop_front();
-                        
-            item_set_type c;
-            for( typename state_type::items_type::iterator i = s->items.begin() ;
-                 i != s->items.end() ;
-                 ++i ) {
-                c.insert( (*i).first );
-            }
-            make_honalee_closure( c, first, g );
-                        
-            for( typename item_set_type::const_iterator i = c.begin() ; i != c.end() ; ++i ) {
-                bool kernel = false;
-
-                typename state_type::items_type::const_iterator j = s->items.find( *i );
-                if( j != s->items.end() ) {
-                    kernel = (*j).second.kernel;
-                }
+    terminal_type eof("$", Traits::eof());
 
-                mark_type m( kernel );
-                if( (*i).over() ) {
-                    // reduced
-                    m.markReduce( (*i).rule() );
-                }
-                s->items[*i] = m;
-            }
+    report_phase(options, "FIRST");
+    check_reachable(g);
 
-            std::vector< state_ptr > unimpcompleted;
-            int state = 0;
-            typename std::deque< state_ptr >::const_iterator i = doneList.begin();
-            typename std::deque< state_ptr >::const_iterator j = incList.begin();
-            for(;;){
-                state_ptr gSet;
-                if( state == 0 ) {
-                    if( i == doneList.end() ) {
-                        state = 1;
-                    } else {
-                        gSet = *i;
-                        ++i;
-                    }
-                }
-                if( state == 1 ) {
-                    if( j == incList.end() ) break;
-                    gSet = *j;
-                    ++j; 
-                }
+    dense_grammar_type dg(g, std::vector<terminal_type> { eof });
 
-                if( !equal_core( *s, *gSet ) ) { continue; }
-                if( rrconflict( *s, *gSet ) ) {
-                    std::cerr << "!!!!!!!!!!!!!!!! reduce/reduce conflict !!!!!!!!!!!!!!!!\n";
-                    continue;
-                }
+    dense_first df;
+    make_dense_first(df, dg);
 
-#if 0
-                std::cerr << "<<<<<<<< marge occured >>>>>>>>\n";
-                                
-                std::cerr << "merge: \n";
-                std::cerr << *s;
-                                
-                std::cerr << "into: \n";
-                std::cerr << *gSet;
-#endif
-
-                bool added_items, added_shift_items;
-                merge( added_items, added_shift_items, *gSet, *s );
-                if( added_items ) {
-                    //mergedSetCount++;
-                }
-                                
-#if 0
-                std::cerr << "result: \n";
-                std::cerr << "added_items: " << added_items << std::endl;
-                std::cerr << "added_shift_items: " << added_shift_items << std::endl;
-
-                std::cerr << *gSet;
-#endif
-                                
-                if( comeFrom ) {
-                    for( typename state_type::items_type:: iterator i = comeFrom->items.begin() ;
-                         i != comeFrom->items.end() ;
-                         ++i ) {
-                        if( (*i).second.action == mark_type::action_shift &&
-                            (*i).second.goto_state == s ) {
-                            (*i).second.goto_state = gSet;
-                        }
-                    }
-                }
+    table.set_grammar(g);
 
-                if( gSet->complete && added_shift_items ) {
-                    for( typename state_type::items_type::iterator i = gSet->items.begin() ;
-                         i != gSet->items.end() ;
-                         ++i ) {
-                        if( (*i).second.action == mark_type::action_shift ) {
-                            (*i).second.markNil();
-                        }
-                    }
-                    gSet->complete = false;
-                    unimpcompleted.push_back( gSet );
-                }
-
-                s.reset();
-                break;
-            }
-
-            for( typename std::vector< state_ptr >::const_iterator i = unimpcompleted.begin();
-                 i != unimpcompleted.end() ;
-                 ++i ) {
-                doneList.erase( std::find( doneList.begin(), doneList.end(), *i ) );
-                incList.push_back( *i );
-            }
-                        
-            if( s ) {
-                s->number = setCount;
-                setCount++;
-                incList.push_back( s );
-            }
-        }
-
-#if 0
-        print_headline( "doneList", doneList, "i" );
-        print_headline( " incList", incList, "i" );
-        print_headline( "toDoList", toDoList, "i" );
-
-        std::cerr << "<doneList>\n";
-        print_list_indirect( std::cerr, doneList );
-        std::cerr << "<incList>\n";
-        print_list_indirect( std::cerr, incList );
-        std::cerr << "<toDoList>\n";
-        print_list_indirect( std::cerr, toDoList );
-        //std::cerr << "<comeFrom>\n";
-        //std::cerr << comeFrom->number << std::endl;
-#endif
-
-        ++n;
-        if( n == 15 ) exit(0);
-    }
-
-#if 0
-    std::cerr << "<doneList>\n";
-    print_list_indirect( std::cerr, doneList );
-#endif
-
-    // e[u̍쐬
-
-    // \̍쐬
-    // [̃Rs[/CfbNX̍쐬
-    std::map< rule_type, int > rule_indices;
-    {
-        for( typename grammar_type::const_iterator j = g.begin() ; j != g.end() ; ++j ) {
-            rule_indices[ *j ] = table.add_rule( *j );
-        }
-    }
-
-    // ԍtւ
-    int m = 0;
-    for( typename std::deque< state_ptr >::iterator i = doneList.begin() ; i != doneList.end() ; ++i ) {
-        (*i)->number = m; m++;             
-    }
-
-    table.first_state( 0 );
-
-    // ڐA
-    for( typename std::deque< state_ptr >::const_iterator i = doneList.begin() ; i != doneList.end() ; ++i ) {
-        const state_type&                       ss = *(*i);             // honalee state
-        typename parsing_table_type::state&     ds = table.add_state(); // table state
-
-        ds.no = ss.number;
-        for( typename state_type::items_type::const_iterator j = ss.items.begin() ;
-             j != ss.items.end() ;
-             ++j ) {
-            const item_type& item = (*j).first;
-            const mark_type& mark = (*j).second;
-
-            switch( mark.action ) {
-            case mark_type::action_shift: {
-                if( mark.shift_symbol.is_terminal() ) {
-                    typename parsing_table_type::action action;
-                    action.type             = action_shift;
-                    action.dest_index       = mark.goto_state->number;
-                    action.rule_index       = rule_indices[ item.rule() ];
-                    ds.action_table[ mark.shift_symbol.token() ] = action;
-                } else {
-                    ds.goto_table[ mark.shift_symbol ] = mark.goto_state->number;
-                }
-                break;
-            }
-            case mark_type::action_reduce: 
-                if( item.rule() == g.root_rule() ) {
-                    typename parsing_table_type::action a;
-                    a.type          = action_accept;
-                    a.dest_index    = 0xdeadbeaf;
-                    a.rule_index    = rule_indices[ item.rule() ];
-                    ds.action_table[ Traits::eof() ] = a;
-                } else {
-                    typename parsing_table_type::action a;
-                    a.type          = action_reduce;
-                    a.dest_index    = 0xdeadbeaf;
-                    a.rule_index    = rule_indices[ item.rule() ];
-                    ds.action_table[ item.lookahead().token() ] = a;
-                }
-                break;
-            case mark_type::action_nil:;
-            }                        
-        }
-    }
+    report_phase(options, "LR(1)");
+    dense_automaton I;
+    std::vector<std::vector<lookahead_set>> la;
+    make_minimal_lr1_automaton(I, la, dg, df, dg.terminal_id(eof.token()));
+    report_automaton(options, I);
 
+    report_phase(options, "fill");
+    fill_parsing_table(
+        table, dg, df, I, la, error_token, srr, rrr, options.threads);
+    report_phase(options, nullptr);
 }
 
-template < class Token, class Traits >
+template <class Token, class Traits>
 void
 make_lr1_table(
-    parsing_table< Token, Traits >& table,
-    const grammar< Token, Traits >& g )
-{
-    make_lr1_table( table, g, null_reporter< Token, Traits >(), null_reporter< Token, Traits >() );
+    parsing_table<Token, Traits>&   table,
+    const grammar<Token, Traits>&   g,
+    Token                           error_token = Token(-1)) {
+    make_lr1_table(
+        table,
+        g,
+        error_token,
+        null_reporter<Token, Traits>(),
+        null_reporter<Token, Traits>());
 }
 
 } // namespace gr
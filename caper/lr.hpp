@@ -11,9 +11,12 @@
 #include <map>
 #include <unordered_map>
 #include <vector>
+#include <memory>
+#include <algorithm>
 #include <sstream>
 #include <stdexcept>
 #include "grammar.hpp"
+#include "dense.hpp"
 
 namespace zw {
 
@@ -402,41 +405,29 @@ void make_first(
     first_collection<Token, Traits>&    first,
     const terminal_set<Token, Traits>&  terminals,
     const grammar<Token, Traits>&       g) {
-    typedef symbol_set<Token, Traits>     symbol_set_type;
 
     // first̒l terminal | epsilon (nonterminal͂肦Ȃ)
 
-    // nullable
-    symbol_set_type nullable;
-
-    // For each terminal symbol Z, FIRST[Z] = { Z }.
-    for (const auto& x: terminals) {
-        first[x].insert(x);
-    }
-
-    // repeat until FIRST and nullable did not change in this iteration.
-    bool repeat;
-    do {
-        repeat = false;
-
-        // for each production X -> Y1Y2...Yk
-        for (const auto& rule: g) {
-            // if Y1...Yk are all nullable(or if k = 0)
-            for (const auto& e: rule.right()) {
-                repeat = repeat || merge_sets(first[rule.left()], first[e]);
-                if (!is_nullable(nullable, e)) {
-                    goto next;
-                }
-            }
-            repeat = repeat || nullable.insert(rule.left()).second;
-
-          next:
-            ;
+    // computed on the integer encoding (dense.hpp)
+    dense_grammar<Token, Traits> dg(
+        g,
+        std::vector<terminal<Token, Traits>>(
+            terminals.begin(), terminals.end()));
+
+    dense_first df;
+    make_dense_first(df, dg);
+
+    for (int x = 0 ; x < dg.symbol_count() ; x++) {
+        auto& s = first[dg.symbol(x)];
+        const lookahead_set& f = df.first[x];
+        for (size_t t = f.find_first() ;
+             t != lookahead_set::npos ;
+             t = f.find_next(t)) {
+            s.insert(dg.symbol(int(t)));
+        }
+        if (df.nullable[x]) {
+            s.insert(epsilon<Token, Traits>());
         }
-    } while(repeat);
-
-    for (const auto& x: nullable) {
-        first[x].insert(epsilon<Token, Traits>());
     }
 }
 
@@ -485,43 +476,24 @@ void make_follow(
     const grammar<Token, Traits>&           g,
     const terminal<Token, Traits>&          eof) {
 
-    typedef symbol_set<Token, Traits>   symbol_set_type;
+    // FIRST is recomputed on the integer encoding; it takes linear time
+    dense_grammar<Token, Traits> dg(
+        g, std::vector<terminal<Token, Traits>> { eof });
 
-    // nullable
-    follow[g.root_rule().left()].insert(eof);
+    dense_first df;
+    make_dense_first(df, dg);
 
-    // repeat until FOLLOW and nullable did not change in this iteration.
-    bool repeat;
-    do {
-        repeat = false;
-
-        // for each production X -> Y1Y2...Yk
-        for (const auto& rule: g) {
-            const auto& follow_a = follow[rule.left()];
-            const auto& right = rule.right();
-
-            // if Y1...Yk are all nullable(or if k = 0)
-            size_t right_size = right.size();
-            for (size_t i = 0 ; i < right_size ; i++) {
-                auto& follow_b = follow[right[i]];
-
-                symbol_set_type s;
-                make_range_first(s, first, right.begin() + 1, right.end());
-
-                bool trail = false;
-                for (const auto& k: s) {
-                    if (k.is_epsilon()) {
-                        trail = true;
-                    } else {
-                        repeat = repeat || follow_b.insert(k).second;
-                    }
-                }
-                if (trail) {
-                    repeat = repeat || merge_sets(follow_b, follow_a);
-                }
-            }
+    std::vector<lookahead_set> f;
+    make_dense_follow(f, dg, df, dg.terminal_id(eof.token()));
+
+    for (int x = 0 ; x < dg.symbol_count() ; x++) {
+        auto& s = follow[dg.symbol(x)];
+        for (size_t t = f[x].find_first() ;
+             t != lookahead_set::npos ;
+             t = f[x].find_next(t)) {
+            s.insert(dg.symbol(int(t)));
         }
-    } while(repeat);
+    }
 }
 
 /*============================================================================
@@ -714,46 +686,22 @@ void
 make_lr0_collection(
     lr0_collection<Token, Traits>&        C,
     const grammar<Token, Traits>&         g) {
-    typedef symbol<Token, Traits>           symbol_type;
     typedef core<Token, Traits>             core_type; 
-    typedef lr0_collection<Token, Traits>   lr0_collection_type; 
-    typedef symbol_set<Token, Traits>       symbol_set_type; 
     typedef core_set<Token, Traits>         core_set_type; 
 
-    // L̎W
-    symbol_set_type syms;
-    for (const auto& r: g) {
-        syms.insert(r.left());
-        syms.insert(r.right().begin(), r.right().end());
-    }
-
-    // W̍쐬
-    core_set_type s;
-    s.insert(core_type(g.root_rule(), 0));
-    make_lr0_closure(s, g);
-    C.insert(s);
+    // built on the integer encoding (dense.hpp)
+    dense_grammar<Token, Traits> dg(g, std::vector<terminal<Token, Traits>>());
 
-    size_t C_size;
-    do {
-        lr0_collection_type new_collection; // }鍀W
-
-        C_size = C.size();
-
-        for (const core_set_type& I: C) {
-            for (const symbol_type& X: syms) {
-                core_set_type I_dash;
-                make_lr0_goto(I_dash, I, X, g);
-
-                if (!I_dash.empty()) {
-                    new_collection.insert(std::move(I_dash));
-                }
-            }
-        }
+    dense_automaton I;
+    make_dense_lr0_automaton(I, dg);
 
-        for (auto&& c: new_collection) {
-            C.insert(c);
+    for (const auto& state: I.states) {
+        core_set_type s;
+        for (dense_core x: state.cores) {
+            s.insert(core_type(dg.rule(dense_rule(x)), dense_cursor(x)));
         }
-    } while (C_size != C.size());
+        C.insert(std::move(s));
+    }
 }
 
 /*============================================================================
@@ -844,6 +792,7 @@ public:
         typedef item_set<Token, Traits>                 item_set_type;
         typedef core_set<Token, Traits>                 core_set_type;
         typedef std::map<Token, action>                 action_table_type;
+        typedef std::multimap<Token, action>            alternative_table_type;
         typedef std::map<symbol_type, int>              goto_table_type; // index to states_
         typedef std::map<core_type, terminal_set_type>  generate_map_type;
         typedef std::set<std::pair<int, core_type>>     propagate_type;
@@ -860,6 +809,9 @@ public:
         action_table_type       action_table;
         bool                    handle_error    = false;
 
+        // the actions that conflicts resolved away, for GLR parsers
+        alternative_table_type  alternative_table;
+
         state(int n) : no(n) {}
     };
 
@@ -957,6 +909,312 @@ std::ostream& operator<<(
     return os;
 }
 
+/*============================================================================
+ *
+ * class compact_table
+ *
+ * \zς݂͕̉\
+ *
+ * a parsing_table frozen for use: construction data (cores, items,
+ * lookahead maps) is dropped, and the actions and gotos of all states
+ * are kept in two flat arrays, each state being a sorted range of them.
+ * The arrays never change after construction, so copies share them.
+ *
+ *==========================================================================*/
+
+template <class Token, class Traits>
+class compact_table {
+public:
+    typedef Token                                   token_type;
+    typedef Traits                                  traits_type;
+    typedef parsing_table<Token, Traits>            source_type;
+    typedef typename source_type::grammar_type      grammar_type;
+    typedef typename source_type::rule_type         rule_type;
+    typedef nonterminal<Token, Traits>              nonterminal_type;
+
+    struct action {
+        action_t    type;
+        int         dest_index; // index to states
+        int         rule_index; // index to the grammar
+    };
+
+    // (key, value) pairs sorted by key
+    template <class Key, class Value>
+    class row {
+    public:
+        typedef std::pair<Key, Value>   value_type;
+        typedef const value_type*       const_iterator;
+
+        row() : b_(nullptr), e_(nullptr) {}
+        row(const_iterator b, const_iterator e) : b_(b), e_(e) {}
+
+        const_iterator begin() const { return b_; }
+        const_iterator end() const   { return e_; }
+        size_t size() const          { return e_ - b_; }
+        bool empty() const           { return b_ == e_; }
+
+        const_iterator find(const Key& k) const {
+            const_iterator i = std::lower_bound(
+                b_, e_, k,
+                [](const value_type& x, const Key& y) {
+                    return x.first < y;
+                });
+            return i != e_ && !(k < (*i).first) ? i : e_;
+        }
+
+    private:
+        const_iterator b_;
+        const_iterator e_;
+    };
+
+    typedef row<Token, action>              action_table_type;
+    typedef row<nonterminal_type, int>      goto_table_type; // index to states
+
+    struct state {
+        int                 no;
+        action_table_type   action_table;
+        goto_table_type     goto_table;
+        bool                handle_error;
+        action_table_type   alternative_table;  // resolved away, for GLR
+    };
+
+    typedef std::vector<state> states_type;
+
+public:
+    compact_table() : imp(std::make_shared<table_imp>()) {}
+    explicit compact_table(const source_type& x) { freeze(x, nullptr); }
+
+    // releases the states of x as they are copied, so that the two
+    // tables are not held at once
+    explicit compact_table(source_type&& x) { freeze(x, &x.states()); }
+
+    int first_state() const { return imp->first; }
+    const states_type& states() const { return imp->states; }
+    const grammar_type& get_grammar() const { return imp->grammar; }
+
+    const rule_type& rule(const action& a) const {
+        return imp->grammar.at(a.rule_index);
+    }
+
+    // the table with the unit rules A -> X that eliminable accepts
+    // bypassed: a shift or goto into a state that does nothing but reduce
+    // by such a rule goes on to the goto of A instead, so the parser skips
+    // the reduction and the value of X stands for A.  the states no
+    // longer reached are dropped
+    template <class Eliminable>
+    compact_table bypass_unit_rules(Eliminable eliminable) const {
+        const states_type& ss = imp->states;
+        size_t n = ss.size();
+
+        // the rule by which a state does nothing but reduce, -1 if none
+        std::vector<int> unit(n, -1);
+        for (size_t i = 0 ; i < n ; i++) {
+            const state& s = ss[i];
+            if (s.action_table.empty() || !s.goto_table.empty() ||
+                !s.alternative_table.empty()) {
+                continue;
+            }
+            int r = (*s.action_table.begin()).second.rule_index;
+            for (const auto& y: s.action_table) {
+                if (y.second.type != action_reduce ||
+                    y.second.rule_index != r) {
+                    r = -1;
+                    break;
+                }
+            }
+            if (0 <= r && imp->grammar.at(r).right().size() == 1 &&
+                eliminable(imp->grammar.at(r))) {
+                unit[i] = r;
+            }
+        }
+
+        // where a shift or goto from s to state to ends up; bounded, for
+        // a cycle of unit rules
+        auto bypass = [&](const state& s, int to) {
+            for (size_t k = 0 ; k < n && 0 <= unit[to] ; k++) {
+                auto g = s.goto_table.find(
+                    imp->grammar.at(unit[to]).left());
+                if (g == s.goto_table.end()) { break; }
+                to = (*g).second;
+            }
+            return to;
+        };
+
+        std::vector<std::vector<typename action_table_type::value_type>>
+            actions(n);
+        std::vector<std::vector<typename goto_table_type::value_type>>
+            gotos(n);
+        std::vector<std::vector<typename action_table_type::value_type>>
+            alternatives(n);
+        for (size_t i = 0 ; i < n ; i++) {
+            for (const auto& y: ss[i].action_table) {
+                actions[i].push_back(y);
+                if (y.second.type == action_shift) {
+                    actions[i].back().second.dest_index =
+                        bypass(ss[i], y.second.dest_index);
+                }
+            }
+            for (const auto& y: ss[i].goto_table) {
+                gotos[i].push_back(
+                    std::make_pair(y.first, bypass(ss[i], y.second)));
+            }
+            // reductions only, with no state to renumber
+            alternatives[i].assign(
+                ss[i].alternative_table.begin(),
+                ss[i].alternative_table.end());
+        }
+
+        // the states still reached, numbered in their order
+        std::vector<int> index(n, -1);
+        std::vector<int> open { imp->first };
+        index[imp->first] = 0;
+        while (!open.empty()) {
+            int i = open.back();
+            open.pop_back();
+            auto reach = [&](int j) {
+                if (index[j] < 0) {
+                    index[j] = 0;
+                    open.push_back(j);
+                }
+            };
+            for (const auto& y: actions[i]) {
+                if (y.second.type == action_shift) {
+                    reach(y.second.dest_index);
+                }
+            }
+            for (const auto& y: gotos[i]) { reach(y.second); }
+        }
+        int m = 0;
+        for (auto& x: index) {
+            if (0 <= x) { x = m++; }
+        }
+
+        auto t = std::make_shared<table_imp>();
+        size_t action_count = 0;
+        size_t goto_count = 0;
+        size_t alternative_count = 0;
+        for (size_t i = 0 ; i < n ; i++) {
+            if (index[i] < 0) { continue; }
+            action_count += actions[i].size();
+            goto_count += gotos[i].size();
+            alternative_count += alternatives[i].size();
+        }
+        t->actions.reserve(action_count);
+        t->gotos.reserve(goto_count);
+        t->alternatives.reserve(alternative_count);
+
+        // the arrays are not reallocated once reserved
+        for (size_t i = 0 ; i < n ; i++) {
+            if (index[i] < 0) { continue; }
+            auto ab = t->actions.data() + t->actions.size();
+            for (auto y: actions[i]) {
+                if (y.second.type == action_shift) {
+                    y.second.dest_index = index[y.second.dest_index];
+                }
+                t->actions.push_back(y);
+            }
+            auto gb = t->gotos.data() + t->gotos.size();
+            for (const auto& y: gotos[i]) {
+                t->gotos.push_back(std::make_pair(y.first, index[y.second]));
+            }
+            auto lb = t->alternatives.data() + t->alternatives.size();
+            for (const auto& y: alternatives[i]) {
+                t->alternatives.push_back(y);
+            }
+            t->states.push_back(
+                state {
+                    index[i],
+                    action_table_type(
+                        ab, t->actions.data() + t->actions.size()),
+                    goto_table_type(
+                        gb, t->gotos.data() + t->gotos.size()),
+                    ss[i].handle_error,
+                    action_table_type(
+                        lb,
+                        t->alternatives.data() + t->alternatives.size()) });
+        }
+        t->grammar = imp->grammar;
+        t->first = index[imp->first];
+
+        compact_table x;
+        x.imp = t;
+        return x;
+    }
+
+private:
+    void freeze(const source_type& x,
+                typename source_type::states_type* release) {
+        auto t = std::make_shared<table_imp>();
+
+        size_t action_count = 0;
+        size_t goto_count = 0;
+        size_t alternative_count = 0;
+        for (const auto& s: x.states()) {
+            action_count += s.action_table.size();
+            goto_count += s.goto_table.size();
+            alternative_count += s.alternative_table.size();
+        }
+        t->actions.reserve(action_count);
+        t->gotos.reserve(goto_count);
+        t->alternatives.reserve(alternative_count);
+
+        // the arrays are not reallocated once reserved
+        for (size_t i = 0 ; i < x.states().size() ; i++) {
+            const auto& s = x.states()[i];
+            auto ab = t->actions.data() + t->actions.size();
+            for (const auto& y: s.action_table) {
+                const auto& a = y.second;
+                t->actions.push_back(
+                    std::make_pair(
+                        y.first,
+                        action { a.type, a.dest_index, int(a.rule.id()) }));
+            }
+            auto gb = t->gotos.data() + t->gotos.size();
+            for (const auto& y: s.goto_table) {
+                t->gotos.push_back(
+                    std::make_pair(y.first.as_nonterminal(), y.second));
+            }
+            auto lb = t->alternatives.data() + t->alternatives.size();
+            for (const auto& y: s.alternative_table) {
+                const auto& a = y.second;
+                t->alternatives.push_back(
+                    std::make_pair(
+                        y.first,
+                        action { a.type, a.dest_index, int(a.rule.id()) }));
+            }
+            t->states.push_back(
+                state {
+                    s.no,
+                    action_table_type(
+                        ab, t->actions.data() + t->actions.size()),
+                    goto_table_type(
+                        gb, t->gotos.data() + t->gotos.size()),
+                    s.handle_error,
+                    action_table_type(
+                        lb,
+                        t->alternatives.data() + t->alternatives.size()) });
+            if (release) {
+                (*release)[i] = typename source_type::state(s.no);
+            }
+        }
+        t->grammar = x.get_grammar();
+        t->first = x.first_state();
+        imp = t;
+    }
+
+    struct table_imp {
+        std::vector<typename action_table_type::value_type>    actions;
+        std::vector<typename goto_table_type::value_type>      gotos;
+        std::vector<typename action_table_type::value_type>    alternatives;
+        states_type                                             states;
+        grammar_type                                            grammar;
+        int                                                     first = -1;
+    };
+
+    std::shared_ptr<const table_imp> imp;
+
+};
+
 template <class Token, class Traits>
 struct null_reporter {
     typedef rule<Token, Traits> rule_type;
@@ -0,0 +1,86 @@
+// Copyright (C) 2006 Naoyuki Hirayama.
+// All Rights Reserved.
+
+// $Id$
+
+#if !defined(ZW_PARALLEL_HPP)
+#define ZW_PARALLEL_HPP
+
+// module: parallel
+//   loop over an index range on worker threads
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <exception>
+#include <algorithm>
+
+namespace zw {
+
+namespace gr {
+
+/*============================================================================
+ *
+ * parallel_for
+ *
+ * calls f(worker, i) for every i in [0, n) on up to 'threads' threads;
+ * worker is in [0, threads) and identifies per-thread scratch storage.
+ * Indices are handed out in small chunks from a shared counter, so fast
+ * workers take over the rest of the range.  The order of the calls is
+ * unspecified; callers write to per-index slots and merge afterwards.
+ * The first exception thrown by f is rethrown after all threads joined.
+ *
+ *==========================================================================*/
+
+inline int worker_count(int threads, int n) {
+    if (threads <= 0) {
+        threads = int(std::thread::hardware_concurrency());
+    }
+    return (std::max)(1, (std::min)(threads, n));
+}
+
+template <class F>
+void parallel_for(int n, int threads, F f) {
+    threads = worker_count(threads, n);
+    if (threads == 1) {
+        for (int i = 0 ; i < n ; i++) { f(0, i); }
+        return;
+    }
+
+    int chunk = (std::max)(1, n / (threads * 16));
+    std::atomic<int> next(0);
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    auto work = [&](int worker) {
+        try {
+            for (;;) {
+                int b = next.fetch_add(chunk);
+                if (n <= b) { break; }
+                int e = (std::min)(n, b + chunk);
+                for (int i = b ; i < e ; i++) { f(worker, i); }
+            }
+        }
+        catch(...) {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!error) { error = std::current_exception(); }
+            next = n;
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (int i = 1 ; i < threads ; i++) {
+        pool.emplace_back(work, i);
+    }
+    work(0);
+    for (auto& x: pool) { x.join(); }
+
+    if (error) { std::rethrow_exception(error); }
+}
+
+} // namespace gr
+
+} // namespace zw
+
+#endif // ZW_PARALLEL_HPP
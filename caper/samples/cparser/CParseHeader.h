@@ -29,7 +29,10 @@ namespace cparser
             fflush(stdout);
         #endif
 
-        Parser<shared_ptr<Node>, ParserSite> parser(ps);
+        std::vector<Token> tokens;
+        std::vector<shared_ptr<Node> > values;
+        tokens.reserve(infos.size());
+        values.reserve(infos.size());
         std::vector<TokenValue >::iterator it, end2 = infos.end();
         for (it = infos.begin(); it != end2; ++it)
         {
@@ -37,16 +40,18 @@ namespace cparser
                 printf("%s\n", scanner.token_to_string(*it).c_str());
                 fflush(stdout);
             #endif
-            if (parser.post(it->m_token, make_shared<TokenValue >(*it)))
-            {
-                if (parser.error())
-                {
-                    ps.location() = it->location();
-                    ps.message(std::string("ERROR: syntax error near ") +
-                        scanner.token_to_string(*it));
-                }
-                break;
-            }
+            tokens.push_back(it->m_token);
+            values.push_back(make_shared<TokenValue >(*it));
+        }
+
+        Parser<shared_ptr<Node>, ParserSite> parser(ps);
+        size_t n = parser.post_range(tokens.data(), values.data(),
+                                     tokens.size());
+        if (n < tokens.size() && parser.error())
+        {
+            ps.location() = infos[n].location();
+            ps.message(std::string("ERROR: syntax error near ") +
+                scanner.token_to_string(infos[n]));
         }
 
         shared_ptr<Node> node;
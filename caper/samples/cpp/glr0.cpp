@@ -0,0 +1,93 @@
+// GLR parsing (-glr)
+//
+// "a * b;" is a declaration of b as a pointer to a, and "a * b * c;" is
+// an expression.  the table can't tell them apart at the first star and
+// shifts, so the LALR parser fails on the expression; the GLR one takes
+// both ways there, and keeps the declaration where both parse.
+
+#include "glr0.ipp"
+#include <iostream>
+#include <iterator>
+#include <string>
+
+class unexpected_char : public std::exception {};
+
+template <class It>
+class scanner {
+public:
+    scanner(It b, It e) : b_(b), e_(e) {}
+
+    glr::Token get(std::string& v) {
+        while (b_ != e_ && isspace(*b_)) { ++b_; }
+        if (b_ == e_) { return glr::token_eof; }
+
+        char c = *b_++;
+        switch (c) {
+            case '*': return glr::token_Star;
+            case ';': return glr::token_Semi;
+        }
+        if (!isalnum(c) && c != '_') {
+            std::cerr << c << std::endl;
+            throw unexpected_char();
+        }
+        v = c;
+        while (b_ != e_ && (isalnum(*b_) || *b_ == '_')) { v += *b_++; }
+        return glr::token_Name;
+    }
+
+private:
+    It b_;
+    It e_;
+};
+
+struct SemanticAction {
+    void syntax_error() {}
+    void stack_overflow() {}
+
+    template <class T>
+    void downcast(T& x, const std::string& y) { x = y; }
+    template <class T>
+    void upcast(std::string& x, const T& y) { x = y; }
+
+    std::string First(const std::string& x) { return x; }
+    std::string Append(const std::string& x, const std::string& y) {
+        return x + "\n" + y;
+    }
+    std::string Declare(const std::string& t, const std::string& x) {
+        return "declare " + x + " as pointer to " + t;
+    }
+    std::string Evaluate(const std::string& x) {
+        return "evaluate " + x;
+    }
+    std::string Identity(const std::string& x) { return x; }
+    std::string Multiply(const std::string& x, const std::string& y) {
+        return "(" + x + " * " + y + ")";
+    }
+};
+
+int main(int, char**) {
+    typedef std::istreambuf_iterator<char> is_iterator;
+    is_iterator b(std::cin);
+    is_iterator e;
+    scanner<is_iterator> s(b, e);
+
+    SemanticAction sa;
+    glr::Parser<std::string, SemanticAction> parser(sa);
+
+    glr::Token token;
+    for (;;) {
+        std::string v;
+        token = s.get(v);
+        if (parser.post(token, v)) { break; }
+    }
+
+    std::string v;
+    if (!parser.error() && parser.accept(v)) {
+        std::cerr << v << std::endl;
+    } else {
+        std::cerr << "syntax error" << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
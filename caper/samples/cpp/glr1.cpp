@@ -0,0 +1,65 @@
+// GLR parsing (-glr) with Parser::snapshot
+//
+// the grammar of glr0.  "a *" forks the parser; restoring a snapshot
+// taken before drops the branches with the frames, so "x ;" is parsed
+// from where the snapshot was.  a snapshot can't be taken while the
+// parser is forked.
+
+#include "glr0.ipp"
+#include <iostream>
+#include <string>
+
+struct SemanticAction {
+    void syntax_error() {}
+    void stack_overflow() {}
+
+    template <class T>
+    void downcast(T& x, const std::string& y) { x = y; }
+    template <class T>
+    void upcast(std::string& x, const T& y) { x = y; }
+
+    std::string First(const std::string& x) { return x; }
+    std::string Append(const std::string& x, const std::string& y) {
+        return x + "\n" + y;
+    }
+    std::string Declare(const std::string& t, const std::string& x) {
+        return "declare " + x + " as pointer to " + t;
+    }
+    std::string Evaluate(const std::string& x) {
+        return "evaluate " + x;
+    }
+    std::string Identity(const std::string& x) { return x; }
+    std::string Multiply(const std::string& x, const std::string& y) {
+        return "(" + x + " * " + y + ")";
+    }
+};
+
+typedef glr::Parser<std::string, SemanticAction> parser_type;
+
+int main(int, char**) {
+    SemanticAction sa;
+    parser_type parser(sa);
+
+    parser.post(glr::token_Name, "q");
+    parser.post(glr::token_Semi, "");
+
+    parser_type::snapshot_type s = parser.snapshot();
+    parser.post(glr::token_Name, "a");
+    parser.post(glr::token_Star, ""); // forks
+    parser.restore(s);
+
+    parser.post(glr::token_Name, "x");
+    parser.post(glr::token_Semi, "");
+    parser.release(s);
+
+    std::string v;
+    if (parser.post(glr::token_eof, "") && !parser.error() &&
+        parser.accept(v)) {
+        std::cerr << v << std::endl; // evaluate q, evaluate x
+    } else {
+        std::cerr << "syntax error" << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,143 @@
+// speculative parsing with Parser::snapshot
+//
+// a word at the head of a statement may be a type name or not.  the
+// driver tries it as a type name, and if the statement doesn't parse,
+// comes back to the snapshot and tries it as a name.
+
+#include "speculative0.ipp"
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+class unexpected_char : public std::exception {};
+
+struct word {
+    enum kind_type { Word, LParen, RParen, Semi, Eof } kind;
+    std::string text;
+};
+
+template <class It>
+std::vector<word> scan(It b, It e) {
+    std::vector<word> words;
+    while (b != e) {
+        char c = *b;
+        if (isspace(c)) { ++b; continue; }
+
+        word w;
+        switch (c) {
+            case '(': w.kind = word::LParen; break;
+            case ')': w.kind = word::RParen; break;
+            case ';': w.kind = word::Semi; break;
+            default:
+                if (!isalnum(c) && c != '_') {
+                    std::cerr << c << std::endl;
+                    throw unexpected_char();
+                }
+                w.kind = word::Word;
+                while (b != e && (isalnum(*b) || *b == '_')) {
+                    w.text += *b++;
+                }
+                words.push_back(w);
+                continue;
+        }
+        ++b;
+        words.push_back(w);
+    }
+    word eof;
+    eof.kind = word::Eof;
+    words.push_back(eof);
+    return words;
+}
+
+struct SemanticAction {
+    void syntax_error() {}
+    void stack_overflow() {}
+
+    template <class T>
+    void downcast(T& x, const std::string& y) { x = y; }
+    template <class T>
+    void upcast(std::string& x, const T& y) { x = y; }
+
+    std::string First(const std::string& x) { return x; }
+    std::string Append(const std::string& x, const std::string& y) {
+        return x + "\n" + y;
+    }
+    std::string Declare(const std::string& t, const std::string& x) {
+        return "declare " + x + " as " + t;
+    }
+    std::string Call(const std::string& f, const std::string& x) {
+        return "call " + f + " with " + x;
+    }
+};
+
+typedef spec::Parser<std::string, SemanticAction> parser_type;
+
+// posts the statement from words[i], taking a leading word as head; true
+// if it parsed.  i is moved past the statement
+bool post_statement(
+    parser_type& parser, const std::vector<word>& words, size_t& i,
+    spec::Token head) {
+    for (; i < words.size() ; i++) {
+        const word& w = words[i];
+        spec::Token token = spec::token_eof;
+        switch (w.kind) {
+            case word::Word:   token = spec::token_Name; break;
+            case word::LParen: token = spec::token_LParen; break;
+            case word::RParen: token = spec::token_RParen; break;
+            case word::Semi:   token = spec::token_Semi; break;
+            case word::Eof:    token = spec::token_eof; break;
+        }
+        if (w.kind == word::Word && head != spec::token_eof) {
+            token = head;
+            head = spec::token_eof;
+        }
+        if (parser.post(token, w.text) && parser.error()) { return false; }
+        if (w.kind == word::Semi || w.kind == word::Eof) {
+            i++;
+            return true;
+        }
+    }
+    return true;
+}
+
+int main(int, char**) {
+    std::istreambuf_iterator<char> b(std::cin);
+    std::istreambuf_iterator<char> e;
+    std::vector<word> words = scan(b, e);
+
+    SemanticAction sa;
+    parser_type parser(sa);
+
+    size_t i = 0;
+    while (i < words.size()) {
+        if (words[i].kind != word::Word) {
+            if (!post_statement(parser, words, i, spec::token_eof)) {
+                std::cerr << "syntax error" << std::endl;
+                return 1;
+            }
+            continue;
+        }
+
+        parser_type::snapshot_type s = parser.snapshot();
+        size_t j = i;
+        if (!post_statement(parser, words, j, spec::token_TypeName)) {
+            // not a declaration; back to the head of the statement
+            parser.restore(s);
+            j = i;
+            if (!post_statement(parser, words, j, spec::token_Name)) {
+                std::cerr << "syntax error" << std::endl;
+                return 1;
+            }
+        }
+        parser.release(s);
+        i = j;
+    }
+
+    std::string v;
+    if (parser.accept(v)) {
+        std::cerr << v << std::endl;
+    }
+
+    return 0;
+}
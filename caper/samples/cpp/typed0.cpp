@@ -0,0 +1,146 @@
+// Copyright (C) 2006 Naoyuki Hirayama.
+// All Rights Reserved.
+
+// $Id$
+
+#include "calc1_ast.hpp"
+#include "typed0.ipp"
+#include <iostream>
+
+class unexpected_char : public std::exception {};
+
+template < class It >
+class scanner {
+ public:
+  typedef int char_type;
+  int eof() { return std::char_traits<char_type>::eof(); }
+
+ public:
+  scanner( It b, It e ) : b_(b), e_(e), c_(b), unget_(eof()) { }
+
+  calc::Token get( calc::Value& v )
+  {
+    v = calc::Value();
+    int c;
+    do {
+      c = getc();
+    } while( isspace( c ) );
+
+    // L
+    if (c == eof()) {
+      return calc::token_eof;
+    } else {
+      switch( c ) {
+        case '+': return calc::token_Add;
+        case '-': return calc::token_Sub;
+        case '*': return calc::token_Mul;
+        case '/': return calc::token_Div;
+      }
+    }
+
+    // 
+    if( isdigit( c ) ) {
+      int n = 0;
+      while( c != eof() && isdigit( c ) ) {
+        n *= 10;
+        n += c - '0';
+        c = getc();
+      }
+      ungetc( c );
+      v = n;
+      return calc::token_Number;
+    }
+
+
+    std::cerr << char(c) << std::endl;
+    throw unexpected_char();
+  }
+
+ private:
+  char_type getc()
+  {
+    int c;
+    if( unget_ != eof() ) {
+      c = unget_;
+      unget_ = eof();
+    } else if( c_ == e_ ) {
+      c = eof(); 
+    } else {
+      c = *c_++;
+    }
+    return c;
+  }
+
+  void ungetc( char_type c )
+  {
+    if( c != eof() ) {
+      unget_ = c;
+    }
+  }
+
+ private:
+  It              b_;
+  It              e_;
+  It              c_;
+  char_type       unget_;
+
+};
+
+struct SemanticAction {
+    // no downcast/upcast: the values come and go unboxed (%typed_stack)
+    void syntax_error(){}
+    void stack_overflow(){}
+
+    Expr* MakeExpr( Term* x ) { return new TermExpr( x ); }
+    Expr* MakeAdd( Expr* x, Term* y )
+    {
+        std::cerr << "expr " << x << " + " << y << std::endl;
+        return new AddExpr( x, new TermExpr( y ) ) ;
+    }
+    Expr* MakeSub( Expr* x, Term* y )
+    {
+        std::cerr << "expr " << x << " - " << y << std::endl;
+        return new SubExpr( x, new TermExpr( y ) ) ;
+    }
+    Term* MakeTerm( int x ) { return new NumberTerm( new Number( x ) ); }
+    Term* MakeMul( Term* x, int y )
+    {
+        std::cerr << "expr " << x << " * " << y << std::endl;
+        return new MulTerm( x, MakeTerm( y ) ) ;
+    }
+    Term* MakeDiv( Term* x, int y )
+    {
+        std::cerr << "expr " << x << " / " << y << std::endl;
+        return new DivTerm( x, MakeTerm( y ) ) ;
+    }
+};
+
+int main( int, char** )
+{
+    // XLi
+    typedef std::istreambuf_iterator<char> is_iterator;
+    is_iterator b( std::cin );   // lɂVC++ڒȂƂ
+    is_iterator e;
+    scanner< is_iterator > s( b, e );
+
+    SemanticAction sa;
+
+    calc::Parser< SemanticAction > parser( sa );
+
+    calc::Token token;
+    for(;;) {
+        calc::Value v;
+        token = s.get( v );
+        if( parser.post( token, std::move( v ) ) ) { break; }
+    }
+
+    calc::Value v;
+    if( parser.accept( v ) ) {
+        Expr* e;
+        calc::Value::downcast( e, v );
+        std::cerr << "accepted\n";
+        std::cerr << e->calc() << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,136 @@
+// Copyright (C) 2006 Naoyuki Hirayama.
+// All Rights Reserved.
+
+// $Id$
+
+// unit rules without an action, with and without --bypass-unit-rules:
+// E : T and the like yield the default value without it, and pass the
+// value of the right side on with it, whether their reductions are
+// bypassed or not
+
+#include "unit0.ipp"
+#include <iostream>
+#include <iterator>
+
+class unexpected_char : public std::exception {};
+
+template <class It>
+class scanner {
+public:
+    typedef int char_type;
+    int eof() { return std::char_traits<char_type>::eof(); }
+
+public:
+    scanner(It b, It e) : b_(b), e_(e), c_(b), unget_(eof()) {}
+
+    unit::Token get(int& v) {
+        v = 0;
+        int c;
+        do {
+            c = getc();
+        } while (isspace(c));
+
+        if (c == eof()) {
+            return unit::token_eof;
+        } else {
+            switch (c) {
+                case '+': return unit::token_Plus;
+                case '*': return unit::token_Star;
+                case '(': return unit::token_LParen;
+                case ')': return unit::token_RParen;
+            }
+        }
+
+        if (isdigit(c)) {
+            int n = 0;
+            while (c != eof() && isdigit(c)) {
+                n *= 10;
+                n += c - '0';
+                c = getc();
+            }
+            ungetc(c);
+            v = n;
+            return unit::token_Number;
+        }
+
+        std::cerr << char(c) << std::endl;
+        throw unexpected_char();
+    }
+
+private:
+    char_type getc() {
+        int c;
+        if (unget_ != eof()) {
+            c = unget_;
+            unget_ = eof();
+        } else if (c_ == e_) {
+            c = eof();
+        } else {
+            c = *c_++;
+        }
+        return c;
+    }
+
+    void ungetc(char_type c) {
+        if (c != eof()) {
+            unget_ = c;
+        }
+    }
+
+private:
+    It              b_;
+    It              e_;
+    It              c_;
+    char_type       unget_;
+
+};
+
+struct SemanticAction {
+    void syntax_error() {}
+    void stack_overflow() {}
+    void downcast(int& x, int y) { x = y; }
+    void upcast(int& x, int y) { x = y; }
+
+    int Top(int x) {
+        std::cout << "top " << x << std::endl;
+        return x;
+    }
+    int Add(int x, int y) {
+        std::cout << "add " << x << " " << y << std::endl;
+        return x + y;
+    }
+    int Mul(int x, int y) {
+        std::cout << "mul " << x << " " << y << std::endl;
+        return x * y;
+    }
+    int Paren(int x) { return x; }
+};
+
+int main(int, char**) {
+    typedef std::istreambuf_iterator<char> is_iterator;
+    is_iterator b(std::cin);
+    is_iterator e;
+    scanner<is_iterator> s(b, e);
+
+    SemanticAction sa;
+    unit::Parser<int, SemanticAction> parser(sa);
+
+    unit::Token token;
+    for (;;) {
+        int v;
+        token = s.get(v);
+        if (parser.post(token, v)) { break; }
+    }
+
+    if (parser.error()) {
+        std::cerr << "error occured: " << unit::token_label(token) << std::endl;
+        return 1;
+    }
+
+    int v;
+    if (parser.accept(v)) {
+        std::cout << "accepted " << v << std::endl;
+    }
+
+    return 0;
+}